@@ -0,0 +1,66 @@
+#include <new>
+#include "arena.h"
+
+/**
+ * @brief Arena::Arena Creates an empty arena. No memory is allocated until
+ * it is first needed.
+ * @param blockSize Size in bytes of each block requested from the heap
+ */
+Arena::Arena(size_t blockSize) {
+    this->blockSize = blockSize;
+}
+
+/**
+ * @brief Arena::~Arena Destructor. Frees every block.
+ */
+Arena::~Arena() {
+    for (std::vector<Block>::iterator iter = blocks.begin(); iter != blocks.end(); ++iter) {
+        ::operator delete(iter->data);
+    }
+}
+
+/**
+ * @brief Arena::allocate Returns uninitialised memory which stays valid
+ * until the next reset().
+ * @param bytes Number of bytes needed
+ * @param align Required alignment of the memory
+ * @return The allocated memory
+ */
+void* Arena::allocate(size_t bytes, size_t align) {
+    while (currentBlock < blocks.size()) {
+        size_t start = (used + align - 1) / align * align;
+        if (start + bytes <= blocks[currentBlock].size) {
+            used = start + bytes;
+            return blocks[currentBlock].data + start;
+        }
+        // Doesn't fit --> Move on to the next block (left over from a previous tick)
+        currentBlock++;
+        used = 0;
+    }
+    // Out of blocks --> Allocate another, big enough for this request
+    Block block;
+    block.size = bytes + align > blockSize ? bytes + align : blockSize;
+    block.data = static_cast<char*>(::operator new(block.size));
+    blocks.push_back(block);
+    currentBlock = blocks.size() - 1;
+    used = 0;
+    return allocate(bytes, align);
+}
+
+/**
+ * @brief Arena::reset Frees everything allocated from the arena. The
+ * blocks themselves are kept to be reused.
+ */
+void Arena::reset() {
+    currentBlock = 0;
+    used = 0;
+}
+
+/**
+ * @brief Arena::forThread
+ * @return The arena belonging to the calling thread
+ */
+Arena& Arena::forThread() {
+    static thread_local Arena arena;
+    return arena;
+}
@@ -0,0 +1,61 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <vector>
+
+/*
+ * Bump allocator for short-lived scratch memory. Allocating just moves a
+ * pointer along the current block, and everything is freed at once by
+ * reset(). Each thread has its own arena (see Arena::forThread()), which
+ * is reset at the start of every tick, so blocks are reused from tick to
+ * tick and scratch memory never touches the heap once warmed up.
+ */
+class Arena {
+public:
+    Arena(size_t blockSize = 64 * 1024);
+    ~Arena();
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t));
+    void reset();
+    static Arena& forThread();
+
+private:
+    struct Block {
+        char *data;
+        size_t size;
+    };
+
+    size_t blockSize; // Size of newly allocated blocks
+    std::vector<Block> blocks;
+    size_t currentBlock = 0; // Index of the block being allocated from
+    size_t used = 0; // Bytes used in the current block
+};
+
+/*
+ * Standard library allocator which takes its memory from an Arena, e.g.
+ * std::vector<Body*, ArenaAllocator<Body*>>. Deallocation does nothing;
+ * the memory is reclaimed when the arena is reset.
+ */
+template <typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    ArenaAllocator(Arena &arena) : arena(&arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U> &other) const { return arena != other.arena; }
+
+    Arena *arena;
+};
+
+#endif // ARENA_H
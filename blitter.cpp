@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <cmath>
+#include "blitter.h"
+#ifdef BLITTER_AVX2
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief blendPixel Blends a premultiplied source pixel over a destination
+ * pixel: dst * (255 - source alpha) / 255 + src. Two channels are worked on
+ * at once, each in its own 16 bits.
+ * @param src The source pixel
+ * @param dst The destination pixel
+ * @return The blended pixel
+ */
+static inline quint32 blendPixel(quint32 src, quint32 dst) {
+    quint32 inverseAlpha = 255 - (src >> 24);
+    quint32 rb = (dst & 0x00ff00ff) * inverseAlpha;
+    rb = ((rb + ((rb >> 8) & 0x00ff00ff) + 0x00800080) >> 8) & 0x00ff00ff;
+    quint32 ag = ((dst >> 8) & 0x00ff00ff) * inverseAlpha;
+    ag = (ag + ((ag >> 8) & 0x00ff00ff) + 0x00800080) & 0xff00ff00;
+    return src + rb + ag;
+}
+
+/**
+ * @brief lerpPixel Mixes two pixels, each channel weighted by (128 - f) and f.
+ * @param a The pixel at f = 0
+ * @param b The pixel at f = 128
+ * @param f How far from a to b, from 0 to 128
+ * @return The mixed pixel
+ */
+static inline quint32 lerpPixel(quint32 a, quint32 b, int f) {
+    quint32 rb = ((a & 0x00ff00ff) * static_cast<quint32>(128 - f) +
+                  (b & 0x00ff00ff) * static_cast<quint32>(f)) >> 7;
+    quint32 ag = (((a >> 8) & 0x00ff00ff) * static_cast<quint32>(128 - f) +
+                  ((b >> 8) & 0x00ff00ff) * static_cast<quint32>(f)) >> 7;
+    return (rb & 0x00ff00ff) | ((ag & 0x00ff00ff) << 8);
+}
+
+/**
+ * @brief Blitter::blend Blends one premultiplied pixel over another, for
+ * drawing which isn't copied from an image.
+ * @param src The source pixel
+ * @param dst The destination pixel
+ * @return The blended pixel
+ */
+quint32 Blitter::blend(quint32 src, quint32 dst) {
+    return blendPixel(src, dst);
+}
+
+/**
+ * @brief Blitter::blit Draws the source image scaled to fill the target
+ * rectangle, blending it over the destination. Only the pixels whose
+ * centres are inside both the target and the clip rectangle are drawn.
+ * @param dst First byte of the destination, a premultiplied ARGB32 image
+ * @param dstStride Bytes per line of the destination
+ * @param clip Pixels of the destination which may be drawn to
+ * @param src The sprite, a premultiplied ARGB32 image
+ * @param target Where to draw the sprite, in destination pixels
+ * @param sampling How to pick source pixels when scaling
+ */
+void Blitter::blit(uchar *dst, int dstStride, const QRect &clip,
+                   const QImage &src, const QRectF &target, Sampling sampling) {
+    if (src.isNull() || target.width() <= 0 || target.height() <= 0) return;
+    // Pixels whose centres are inside the target and the clip
+    int left = std::max(static_cast<int>(ceil(target.left() - 0.5)), clip.left());
+    int right = std::min(static_cast<int>(ceil(target.right() - 0.5)), clip.right() + 1);
+    int top = std::max(static_cast<int>(ceil(target.top() - 0.5)), clip.top());
+    int bottom = std::min(static_cast<int>(ceil(target.bottom() - 0.5)), clip.bottom() + 1);
+    if (left >= right || top >= bottom) return;
+
+#ifdef BLITTER_AVX2
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+#endif
+    int srcWidth = src.width();
+    int srcHeight = src.height();
+    double scaleX = srcWidth / target.width();
+    double scaleY = srcHeight / target.height();
+    // Source x coordinates are stepped along each row in 16.16 fixed point
+    int du = static_cast<int>(scaleX * 65536);
+    double startU = (left + 0.5 - target.left()) * scaleX;
+    int count = right - left;
+
+    for (int y = top; y < bottom; y++) {
+        quint32 *dstRow = reinterpret_cast<quint32*>(dst + y * dstStride) + left;
+        double v = (y + 0.5 - target.top()) * scaleY;
+        int done = 0;
+        if (sampling == Nearest) {
+            int sy = std::min(std::max(static_cast<int>(v), 0), srcHeight - 1);
+            const quint32 *srcRow = reinterpret_cast<const quint32*>(src.constScanLine(sy));
+            int u = static_cast<int>(startU * 65536);
+#ifdef BLITTER_AVX2
+            if (hasAvx2) done = blitRowAvx2(dstRow, count, srcRow, srcWidth, u, du);
+#endif
+            blitRow(dstRow + done, count - done, srcRow, srcWidth, u + done * du, du);
+        } else {
+            // Mix the four source pixels around the pixel centre
+            v -= 0.5;
+            int sy0 = static_cast<int>(floor(v));
+            int fy = static_cast<int>((v - sy0) * 128);
+            int sy1 = std::min(std::max(sy0 + 1, 0), srcHeight - 1);
+            sy0 = std::min(std::max(sy0, 0), srcHeight - 1);
+            const quint32 *srcRow0 = reinterpret_cast<const quint32*>(src.constScanLine(sy0));
+            const quint32 *srcRow1 = reinterpret_cast<const quint32*>(src.constScanLine(sy1));
+            int u = static_cast<int>(floor((startU - 0.5) * 65536));
+#ifdef BLITTER_AVX2
+            if (hasAvx2) done = blitRowBilinearAvx2(dstRow, count, srcRow0, srcRow1, fy, srcWidth, u, du);
+#endif
+            blitRowBilinear(dstRow + done, count - done, srcRow0, srcRow1, fy, srcWidth, u + done * du, du);
+        }
+    }
+}
+
+/**
+ * @brief Blitter::blitRow Draws one row, taking the nearest source pixel
+ * for each destination pixel.
+ * @param dst First destination pixel to draw
+ * @param count Number of pixels to draw
+ * @param srcRow Row of the source to take pixels from
+ * @param srcWidth Width of the source
+ * @param u Source x coordinate of the first pixel, in 16.16 fixed point
+ * @param du Source distance between destination pixels, in 16.16 fixed point
+ */
+void Blitter::blitRow(quint32 *dst, int count, const quint32 *srcRow,
+                      int srcWidth, int u, int du) {
+    for (int i = 0; i < count; i++, u += du) {
+        int sx = std::min(std::max(u >> 16, 0), srcWidth - 1);
+        dst[i] = blendPixel(srcRow[sx], dst[i]);
+    }
+}
+
+/**
+ * @brief Blitter::blitRowBilinear Draws one row, mixing the four source
+ * pixels around each destination pixel.
+ * @param dst First destination pixel to draw
+ * @param count Number of pixels to draw
+ * @param srcRow0 Source row above the pixel centres
+ * @param srcRow1 Source row below the pixel centres
+ * @param fy How far the centres are from srcRow0 to srcRow1, from 0 to 128
+ * @param srcWidth Width of the source
+ * @param u Source x coordinate of the first pixel, in 16.16 fixed point
+ * @param du Source distance between destination pixels, in 16.16 fixed point
+ */
+void Blitter::blitRowBilinear(quint32 *dst, int count, const quint32 *srcRow0,
+                              const quint32 *srcRow1, int fy, int srcWidth, int u, int du) {
+    for (int i = 0; i < count; i++, u += du) {
+        int sx0 = u >> 16;
+        int fx = (u >> 9) & 127;
+        int sx1 = std::min(std::max(sx0 + 1, 0), srcWidth - 1);
+        sx0 = std::min(std::max(sx0, 0), srcWidth - 1);
+        quint32 top = lerpPixel(srcRow0[sx0], srcRow0[sx1], fx);
+        quint32 bottom = lerpPixel(srcRow1[sx0], srcRow1[sx1], fx);
+        dst[i] = blendPixel(lerpPixel(top, bottom, fy), dst[i]);
+    }
+}
+
+#ifdef BLITTER_AVX2
+
+/**
+ * @brief blend16Avx2 Blends premultiplied source pixels over destination
+ * pixels, with each channel widened to 16 bits (two pixels per 128 bits).
+ * @param src The source pixels
+ * @param dst The destination pixels
+ * @return The blended pixels, still 16 bits per channel
+ */
+__attribute__((target("avx2")))
+static inline __m256i blend16Avx2(__m256i src, __m256i dst) {
+    // Copy each pixel's alpha into all four of its channels
+    __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)),
+                                           _MM_SHUFFLE(3, 3, 3, 3));
+    __m256i inverseAlpha = _mm256_sub_epi16(_mm256_set1_epi16(255), alpha);
+    __m256i t = _mm256_mullo_epi16(dst, inverseAlpha);
+    // Divide by 255, rounding the same way as blendPixel
+    t = _mm256_add_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), _mm256_set1_epi16(128));
+    return _mm256_add_epi16(_mm256_srli_epi16(t, 8), src);
+}
+
+/**
+ * @brief blend8Avx2 Blends 8 premultiplied source pixels over 8 destination
+ * pixels.
+ * @param src The source pixels
+ * @param dst The destination pixels
+ * @return The blended pixels
+ */
+__attribute__((target("avx2")))
+static inline __m256i blend8Avx2(__m256i src, __m256i dst) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i lo = blend16Avx2(_mm256_unpacklo_epi8(src, zero), _mm256_unpacklo_epi8(dst, zero));
+    __m256i hi = blend16Avx2(_mm256_unpackhi_epi8(src, zero), _mm256_unpackhi_epi8(dst, zero));
+    return _mm256_packus_epi16(lo, hi);
+}
+
+/**
+ * @brief lerp16Avx2 Mixes pixels widened to 16 bits per channel, each
+ * weighted by (128 - f) and f.
+ * @param a The pixels at f = 0
+ * @param b The pixels at f = 128
+ * @param f How far from a to b, from 0 to 128, for each channel
+ * @return The mixed pixels, 16 bits per channel
+ */
+__attribute__((target("avx2")))
+static inline __m256i lerp16Avx2(__m256i a, __m256i b, __m256i f) {
+    __m256i inverse = _mm256_sub_epi16(_mm256_set1_epi16(128), f);
+    return _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(a, inverse), _mm256_mullo_epi16(b, f)), 7);
+}
+
+/**
+ * @brief Blitter::blitRowAvx2 Draws as much of a row as possible 8 pixels
+ * at a time, taking the nearest source pixel for each destination pixel.
+ * Parameters are the same as blitRow().
+ * @return Number of pixels drawn, a multiple of 8
+ */
+__attribute__((target("avx2")))
+int Blitter::blitRowAvx2(quint32 *dst, int count, const quint32 *srcRow,
+                         int srcWidth, int u, int du) {
+    __m256i steps = _mm256_mullo_epi32(_mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0), _mm256_set1_epi32(du));
+    __m256i maxX = _mm256_set1_epi32(srcWidth - 1);
+    __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= count; i += 8, u += 8 * du) {
+        __m256i sx = _mm256_srai_epi32(_mm256_add_epi32(_mm256_set1_epi32(u), steps), 16);
+        sx = _mm256_min_epi32(_mm256_max_epi32(sx, zero), maxX);
+        __m256i src = _mm256_i32gather_epi32(reinterpret_cast<const int*>(srcRow), sx, 4);
+        __m256i *out = reinterpret_cast<__m256i*>(dst + i);
+        _mm256_storeu_si256(out, blend8Avx2(src, _mm256_loadu_si256(out)));
+    }
+    return i;
+}
+
+/**
+ * @brief Blitter::blitRowBilinearAvx2 Draws as much of a row as possible 8
+ * pixels at a time, mixing the four source pixels around each destination
+ * pixel. Parameters are the same as blitRowBilinear().
+ * @return Number of pixels drawn, a multiple of 8
+ */
+__attribute__((target("avx2")))
+int Blitter::blitRowBilinearAvx2(quint32 *dst, int count, const quint32 *srcRow0,
+                                 const quint32 *srcRow1, int fy, int srcWidth, int u, int du) {
+    __m256i steps = _mm256_mullo_epi32(_mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0), _mm256_set1_epi32(du));
+    __m256i maxX = _mm256_set1_epi32(srcWidth - 1);
+    __m256i zero = _mm256_setzero_si256();
+    __m256i fy16 = _mm256_set1_epi16(static_cast<short>(fy));
+    int i = 0;
+    for (; i + 8 <= count; i += 8, u += 8 * du) {
+        __m256i pos = _mm256_add_epi32(_mm256_set1_epi32(u), steps);
+        __m256i sx0 = _mm256_srai_epi32(pos, 16);
+        __m256i sx1 = _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(sx0, _mm256_set1_epi32(1)), zero), maxX);
+        sx0 = _mm256_min_epi32(_mm256_max_epi32(sx0, zero), maxX);
+        // Put each pixel's weight in all four of its bytes, so it can be
+        // widened in the same way as the pixels
+        __m256i fx = _mm256_and_si256(_mm256_srli_epi32(pos, 9), _mm256_set1_epi32(127));
+        fx = _mm256_mullo_epi32(fx, _mm256_set1_epi32(0x01010101));
+
+        __m256i topLeft = _mm256_i32gather_epi32(reinterpret_cast<const int*>(srcRow0), sx0, 4);
+        __m256i topRight = _mm256_i32gather_epi32(reinterpret_cast<const int*>(srcRow0), sx1, 4);
+        __m256i bottomLeft = _mm256_i32gather_epi32(reinterpret_cast<const int*>(srcRow1), sx0, 4);
+        __m256i bottomRight = _mm256_i32gather_epi32(reinterpret_cast<const int*>(srcRow1), sx1, 4);
+        __m256i *out = reinterpret_cast<__m256i*>(dst + i);
+        __m256i d = _mm256_loadu_si256(out);
+
+        __m256i fxLo = _mm256_unpacklo_epi8(fx, zero);
+        __m256i top = lerp16Avx2(_mm256_unpacklo_epi8(topLeft, zero), _mm256_unpacklo_epi8(topRight, zero), fxLo);
+        __m256i bottom = lerp16Avx2(_mm256_unpacklo_epi8(bottomLeft, zero), _mm256_unpacklo_epi8(bottomRight, zero), fxLo);
+        __m256i lo = blend16Avx2(lerp16Avx2(top, bottom, fy16), _mm256_unpacklo_epi8(d, zero));
+
+        __m256i fxHi = _mm256_unpackhi_epi8(fx, zero);
+        top = lerp16Avx2(_mm256_unpackhi_epi8(topLeft, zero), _mm256_unpackhi_epi8(topRight, zero), fxHi);
+        bottom = lerp16Avx2(_mm256_unpackhi_epi8(bottomLeft, zero), _mm256_unpackhi_epi8(bottomRight, zero), fxHi);
+        __m256i hi = blend16Avx2(lerp16Avx2(top, bottom, fy16), _mm256_unpackhi_epi8(d, zero));
+
+        _mm256_storeu_si256(out, _mm256_packus_epi16(lo, hi));
+    }
+    return i;
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef BLITTER_H
+#define BLITTER_H
+
+#include <QImage>
+#include <QRect>
+#include <QRectF>
+
+// The AVX2 code is built for every x86 processor with GCC or Clang, and only
+// used if the processor running it supports AVX2
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BLITTER_AVX2
+#endif
+
+/*
+ * Draws unrotated sprites into premultiplied ARGB32 images, scaling them to
+ * fit the target rectangle and blending them over what is already there.
+ * Much cheaper than a QPainter call per sprite when thousands are drawn.
+ * Uses AVX2 when the processor supports it.
+ */
+class Blitter {
+public:
+    enum Sampling {
+        Nearest = 0,
+        Bilinear = 1
+    };
+
+    static void blit(uchar *dst, int dstStride, const QRect &clip,
+                     const QImage &src, const QRectF &target, Sampling sampling);
+    static quint32 blend(quint32 src, quint32 dst);
+
+private:
+    static void blitRow(quint32 *dst, int count, const quint32 *srcRow,
+                        int srcWidth, int u, int du);
+    static void blitRowBilinear(quint32 *dst, int count, const quint32 *srcRow0,
+                                const quint32 *srcRow1, int fy, int srcWidth, int u, int du);
+#ifdef BLITTER_AVX2
+    static int blitRowAvx2(quint32 *dst, int count, const quint32 *srcRow,
+                           int srcWidth, int u, int du);
+    static int blitRowBilinearAvx2(quint32 *dst, int count, const quint32 *srcRow0,
+                                   const quint32 *srcRow1, int fy, int srcWidth, int u, int du);
+#endif
+};
+
+#endif // BLITTER_H
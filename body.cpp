@@ -2,6 +2,21 @@
 #include <cmath>
 #include <iostream>
 #include "body.h"
+#include "pool.h"
+
+// How many bodies to allocate from the heap at once
+#define BODIES_PER_CHUNK 1024
+
+/**
+ * @brief bodyPool Returns the pool which all bodies are allocated from.
+ * The pool is never destroyed, since the simulation thread may still be
+ * using bodies while the program exits.
+ * @return The pool for Body objects
+ */
+static Pool& bodyPool() {
+    static Pool *pool = new Pool(sizeof(Body), BODIES_PER_CHUNK);
+    return *pool;
+}
 
 /**
  * @brief Body::Body Basic constructor. Initialises variables to invalid values.
@@ -9,8 +24,8 @@
 Body::Body() {
     mass = -1;
     diameter = -1;
-    pos = nullptr;
-    vel = nullptr;
+    pos = Vector(-1, -1);
+    vel = Vector(-1, -1);
     type = Asteroid;
     active = true;
 }
@@ -23,10 +38,11 @@ Body::Body() {
  * @param vel Velocity Vector of body
  * @param type Type of body (see Body::BodyType)
  */
-Body::Body(double mass, double diam, Vector *pos, Vector *vel, BodyType type, int planetType) {
+Body::Body(double mass, double diam, Vector pos, Vector vel, BodyType type, int planetType) {
     this->mass = mass;
     this->diameter = diam;
     this->pos = pos;
+    this->prevPos = pos;
     this->vel = vel;
     this->type = type;
     this->planetType = planetType;
@@ -38,6 +54,27 @@ Body::Body(double mass, double diam, Vector *pos, Vector *vel, BodyType type, in
  * @param type Type of body
  */
 Body::Body(BodyType type) {
+    Random random(static_cast<uint64_t>(std::rand()));
+    init(type, random);
+}
+
+/**
+ * @brief Body::Body Initialises variable to generic values for the specified
+ * type, using the given generator so that the body can be made again exactly.
+ * @param type Type of body
+ * @param random Generator for the body's mass, diameter and sprite
+ */
+Body::Body(BodyType type, Random &random) {
+    init(type, random);
+}
+
+/**
+ * @brief Body::init Sets the mass, diameter and sprite to random values
+ * suitable for the specified type.
+ * @param type Type of body
+ * @param random Generator for the random values
+ */
+void Body::init(BodyType type, Random &random) {
     // Specific mass and diameter for each type
     int rand;
     planetType = 0;
@@ -45,40 +82,40 @@ Body::Body(BodyType type) {
         default:
         case Asteroid:
             // Mass and diam = 2 +/- 1
-            rand = 1 + std::rand() % 3;
+            rand = 1 + random.nextInt(3);
             mass = rand;
             diameter = rand;
             break;
         case Planet:
             // Mass = 150 +/- 100
-            mass = 150 + std::rand() % 101;
+            mass = 150 + random.nextInt(101);
             // Diam = 10 +/- 5
-            diameter = 5 + std::rand() % 11;
-            planetType = std::rand() % 5 + 1; // Random from 1 to 5
+            diameter = 5 + random.nextInt(11);
+            planetType = random.nextInt(5) + 1; // Random from 1 to 5
             break;
         case Star:
             // Mass = 9000 +/- 1000
-            mass = 8000 + std::rand() % 2001;
+            mass = 8000 + random.nextInt(2001);
             // Diam = 50 +/- 10
-            diameter = 40 + std::rand() % 21;
+            diameter = 40 + random.nextInt(21);
             break;
         case WhiteDwarf:
             // Mass = 9000 +/- 1000
-            mass = 8000 + std::rand() % 2001;
+            mass = 8000 + random.nextInt(2001);
             // Diam = 10 +/- 5
-            diameter = 5 + std::rand() % 11;
+            diameter = 5 + random.nextInt(11);
             break;
         case BlackHole:
             // Mass = 30000 +- 5000
-            mass = 25000 + std::rand() % 10001;
+            mass = 25000 + random.nextInt(10001);
             // Diam = 25 +/- 5
-            diameter = 20 + std::rand() % 11;
+            diameter = 20 + random.nextInt(11);
             break;
     }
     //std::cout << "Type: " << type << "\tMass: " << mass << "\tDiam: " << diameter << std::endl;
     // Generic information
-    pos = new Vector(-1, -1);
-    vel = new Vector(-1, -1);
+    pos = Vector(-1, -1);
+    vel = Vector(-1, -1);
     this->type = type;
     active = true;
 }
@@ -86,9 +123,52 @@ Body::Body(BodyType type) {
 /**
  * @brief Body::~Body Destructor.
  */
-Body::~Body() {
-    delete pos;
-    delete vel;
+Body::~Body() {}
+
+/**
+ * @brief Body::operator new Allocates memory for a Body from the body pool.
+ * Subclasses with their own pool (e.g. Rocket) override this; any other
+ * larger subclass falls back to the heap.
+ * @param size Size of the object being allocated
+ * @return Memory for the new Body
+ */
+void* Body::operator new(size_t size) {
+    if (size > bodyPool().getBlockSize()) {
+        return ::operator new(size);
+    }
+    return bodyPool().allocate();
+}
+
+/**
+ * @brief Body::operator delete Returns a Body's memory to the body pool.
+ * @param p The memory to release
+ * @param size Size of the object being deleted
+ */
+void Body::operator delete(void *p, size_t size) {
+    if (size > bodyPool().getBlockSize()) {
+        ::operator delete(p);
+    } else {
+        bodyPool().release(p);
+    }
+}
+
+/**
+ * @brief Body::deleteBodies Deletes every body in the list, returning their
+ * memory to the body pool with a single lock rather than one per body.
+ * @param bodies The bodies to delete. Left holding invalid pointers, so it
+ * should be cleared afterwards
+ */
+void Body::deleteBodies(std::vector<Body*> &bodies) {
+    for (std::vector<Body*>::iterator iter = bodies.begin(); iter != bodies.end(); ++iter) {
+        if ((*iter)->getType() == PlayerRocket) {
+            // Rockets have a pool of their own
+            delete *iter;
+            *iter = nullptr;
+        } else {
+            (*iter)->~Body();
+        }
+    }
+    bodyPool().releaseAll(bodies);
 }
 
 /**
@@ -127,8 +207,8 @@ void Body::setDiameter(double d) {
  * @brief Body::getPos
  * @return The position Vector of the body
  */
-Vector* Body::getPos() const {
-    return pos;
+Vector* Body::getPos() {
+    return &pos;
 }
 
 /**
@@ -136,7 +216,7 @@ Vector* Body::getPos() const {
  * @return The x-coordinate of the body
  */
 double Body::getX() {
-    return pos->getX();
+    return pos.getX();
 }
 
 /**
@@ -144,15 +224,15 @@ double Body::getX() {
  * @return The y-coordinate of the body
  */
 double Body::getY() {
-    return pos->getY();
+    return pos.getY();
 }
 
 /**
  * @brief Body::getVel
  * @return The velocity Vector of the body
  */
-Vector* Body::getVel() const {
-    return vel;
+Vector* Body::getVel() {
+    return &vel;
 }
 
 /**
@@ -160,7 +240,7 @@ Vector* Body::getVel() const {
  * @return The x-velocity of the body
  */
 double Body::getVelX() {
-    return vel->getX();
+    return vel.getX();
 }
 
 /**
@@ -168,7 +248,7 @@ double Body::getVelX() {
  * @return The y-velocity of the body
  */
 double Body::getVelY() {
-    return vel->getY();
+    return vel.getY();
 }
 
 /**
@@ -176,7 +256,8 @@ double Body::getVelY() {
  * @param v New position Vector of the body
  */
 void Body::setPos(Vector *v) {
-    pos = v;
+    pos.set(v);
+    prevPos = pos;
 }
 
 /**
@@ -185,8 +266,9 @@ void Body::setPos(Vector *v) {
  * @param y New y-coordinate of the body
  */
 void Body::setPos(double x, double y) {
-    pos->setX(x);
-    pos->setY(y);
+    pos.setX(x);
+    pos.setY(y);
+    prevPos = pos;
 }
 
 /**
@@ -194,7 +276,8 @@ void Body::setPos(double x, double y) {
  * @param x New x-coordinate of the body
  */
 void Body::setX(double x) {
-    pos->setX(x);
+    pos.setX(x);
+    prevPos = pos;
 }
 
 /**
@@ -202,7 +285,8 @@ void Body::setX(double x) {
  * @param y New y-coordinate of the body
  */
 void Body::setY(double y) {
-    pos->setY(y);
+    pos.setY(y);
+    prevPos = pos;
 }
 
 /**
@@ -210,7 +294,7 @@ void Body::setY(double y) {
  * @param v New velocity Vector of the body
  */
 void Body::setVel(Vector *v) {
-    vel = v;
+    vel.set(v);
 }
 
 /**
@@ -219,8 +303,8 @@ void Body::setVel(Vector *v) {
  * @param y New y-velocity of the body
  */
 void Body::setVel(double x, double y) {
-    vel->setX(x);
-    vel->setY(y);
+    vel.setX(x);
+    vel.setY(y);
 }
 
 /**
@@ -228,7 +312,7 @@ void Body::setVel(double x, double y) {
  * @param x New x-velocity of the body
  */
 void Body::setVelX(double x) {
-    vel->setX(x);
+    vel.setX(x);
 }
 
 /**
@@ -236,7 +320,7 @@ void Body::setVelX(double x) {
  * @param y New y-velocity of the body
  */
 void Body::setVelY(double y) {
-    vel->setY(y);
+    vel.setY(y);
 }
 
 /**
@@ -290,12 +374,65 @@ void Body::setActive(bool b) {
     active = b;
 }
 
+/**
+ * @brief Body::getPrevX
+ * @return The x coordinate of the body before it was last moved
+ */
+double Body::getPrevX() {
+    return prevPos.getX();
+}
+
+/**
+ * @brief Body::getPrevY
+ * @return The y coordinate of the body before it was last moved
+ */
+double Body::getPrevY() {
+    return prevPos.getY();
+}
+
+/**
+ * @brief Body::savePos Remembers the current position as the previous
+ * position. Called before each move, so the body can be drawn anywhere
+ * between the two.
+ */
+void Body::savePos() {
+    prevPos = pos;
+}
+
+/**
+ * @brief Body::translate Moves both the position and the previous position,
+ * so the body doesn't appear to travel between them.
+ * @param dx Distance to move in x
+ * @param dy Distance to move in y
+ */
+void Body::translate(double dx, double dy) {
+    pos.add(dx, dy);
+    prevPos.add(dx, dy);
+}
+
+/**
+ * @brief Body::getTrail
+ * @return Number of the trail holding the body's recent path, or -1 if it
+ * doesn't have one
+ */
+int Body::getTrail() {
+    return trail;
+}
+
+/**
+ * @brief Body::setTrail Sets which trail holds the body's recent path.
+ * @param t Number of the trail, or -1 for none
+ */
+void Body::setTrail(int t) {
+    trail = t;
+}
+
 /**
  * @brief Body::move Move the body by one step by adding its velocity
  * Vector to its position Vector.
  */
 void Body::move() {
-    pos->add(vel);
+    pos.add(&vel);
 }
 
 /**
@@ -313,11 +450,11 @@ void Body::combine(Body *b) {
     // m1v1 + m2v2 = m3v3 = (m1+m2)v3
     // v3 = (m1v1 + m2v2) / (m1 + m2)
     double vx, vy, bMass = b->getMass();
-    vx = (mass * vel->getX() + bMass * b->getVelX()) /
+    vx = (mass * vel.getX() + bMass * b->getVelX()) /
             (mass + bMass);
-    vy = (mass * vel->getY() + bMass * b->getVelY()) /
+    vy = (mass * vel.getY() + bMass * b->getVelY()) /
             (mass + bMass);
-    vel->set(vx, vy);
+    vel.set(vx, vy);
     // Consume mass
     mass += bMass;
 }
@@ -327,7 +464,7 @@ void Body::combine(Body *b) {
  * @return A copy of this Body
  */
 Body* Body::copy() {
-    return new Body(mass, diameter, pos->copy(), vel->copy(), type, planetType);
+    return new Body(mass, diameter, pos, vel, type, planetType);
 }
 
 /**
@@ -336,7 +473,7 @@ Body* Body::copy() {
  * @return A string representation of the body
  */
 std::string Body::toString() {
-    return "pos: " + pos->toString() + ", vel: " + vel->toString();
+    return "pos: " + pos.toString() + ", vel: " + vel.toString();
 }
 
 /**
@@ -346,8 +483,8 @@ std::string Body::toString() {
  * @return True if the two bodies are the sames
  */
 bool Body::operator==(const Body& rhs) {
-    return this->getPos()->equals(rhs.getPos())
-            && this->getVel()->equals(rhs.getVel());
+    Vector rhsPos = rhs.pos, rhsVel = rhs.vel;
+    return pos.equals(&rhsPos) && vel.equals(&rhsVel);
 }
 
 /**
@@ -360,7 +497,7 @@ bool Body::operator==(const Body& rhs) {
  */
 bool Body::isWithin(QRect rect) {
     double radius = diameter / 2.0;
-    double posX = pos->getX(), posY = pos->getY();
+    double posX = pos.getX(), posY = pos.getY();
 
     return (posX + radius >= rect.x()
             && posX - radius <= rect.x() + rect.width()
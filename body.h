@@ -2,8 +2,10 @@
 #define BODY_H
 
 #include <string>
+#include <vector>
 #include <QRect>
 #include "vector.h"
+#include "random.h"
 
 /*
  * Class for a generic body such as an asteroid or star.
@@ -23,18 +25,24 @@ public:
     };
 
     Body();
-    Body(double mass, double diam, Vector *pos, Vector *vel, BodyType type, int planetType);
+    Body(double mass, double diam, Vector pos, Vector vel, BodyType type, int planetType);
     Body(BodyType);
-    ~Body();
+    Body(BodyType, Random &random);
+    virtual ~Body();
+
+    // Bodies are allocated from a pool rather than the heap
+    static void* operator new(size_t size);
+    static void operator delete(void *p, size_t size);
+    static void deleteBodies(std::vector<Body*> &bodies);
 
     double getMass();
     void setMass(double m);
     double getDiameter();
     void setDiameter(double d);
-    Vector* getPos() const;
+    Vector* getPos();
     double getX();
     double getY();
-    Vector* getVel() const;
+    Vector* getVel();
     double getVelX();
     double getVelY();
     void setPos(Vector *v);
@@ -45,6 +53,12 @@ public:
     void setVel(double x, double y);
     void setVelX(double x);
     void setVelY(double y);
+    double getPrevX();
+    double getPrevY();
+    void savePos(); // Remember the position before moving
+    void translate(double dx, double dy); // Move without the body appearing to travel
+    int getTrail();
+    void setTrail(int t);
     int getType();
     void setType(BodyType);
     int getPlanetType();
@@ -61,12 +75,17 @@ public:
 protected:
     double mass;
     double diameter;
-    Vector *pos;
-    Vector *vel;
+    Vector pos;
+    // Position before the body was last moved, for drawing between ticks
+    Vector prevPos;
+    Vector vel;
     BodyType type; // What does the body represent?
     bool active; // Should the body interact with other bodies?
+    int trail = -1; // Which of the simulation's trails holds the body's path?
 
 private:
+    void init(BodyType type, Random &random);
+
     int planetType; // Which planet sprite should the body (planet) have?
 };
 
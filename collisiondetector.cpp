@@ -0,0 +1,194 @@
+#include <cmath>
+#include "collisiondetector.h"
+
+/**
+ * @brief CollisionDetector::~CollisionDetector Destructor.
+ */
+CollisionDetector::~CollisionDetector() {}
+
+/**
+ * @brief CollisionDetector::prepare Called once at the start of each tick,
+ * before any collisions are found. Stores the visible region and scale so
+ * that more accurate checks can be used on screen. Detectors which need to
+ * build any structures from the bodies (e.g. a grid) should do so here.
+ * @param bodies All bodies in the simulation
+ * @param visibleRegion The area visible to the player
+ * @param scale The current scale of the SimulationWidget
+ */
+void CollisionDetector::prepare(std::vector<Body*> &, QRect visibleRegion, double scale) {
+    this->visibleRegion = visibleRegion;
+    this->scale = scale;
+}
+
+/**
+ * @brief SpriteCollisionDetector::SpriteCollisionDetector Creates the
+ * detector.
+ * @param sprites The sprites to use when checking for overlapping bodies
+ */
+SpriteCollisionDetector::SpriteCollisionDetector(Sprites sprites) {
+    this->sprites = sprites;
+}
+
+/**
+ * @brief SpriteCollisionDetector::findCollisions Finds all active bodies
+ * which are colliding with the given body.
+ * @param body The body to find collisions for
+ * @param bodies All bodies in the simulation
+ * @param collisions Filled with the bodies colliding with body
+ */
+void SpriteCollisionDetector::findCollisions(Body *body, std::vector<Body*> &bodies, CollisionList &collisions) {
+    double x = body->getX(), y = body->getY(), diam = body->getDiameter();
+    double otherX, otherY, otherDiam;
+    for (std::vector<Body*>::iterator iter = bodies.begin(), end = bodies.end(); iter != end; ++iter) {
+        // Make sure the two bodies are not the same and that the other body is active
+        if (*iter == body || !(*iter)->isActive()) continue;
+        otherX = (*iter)->getX();
+        otherY = (*iter)->getY();
+        otherDiam = (*iter)->getDiameter();
+        // Are the bodies even remotely close to each other?
+        if (fabs(x - otherX) + fabs(y - otherY) < diam + otherDiam) {
+            // Assuming the two bodies are rectangles, do they overlap?
+            if (fabs(x - otherX) < ((diam + otherDiam) / 2)
+                    && fabs(y - otherY) < ((diam + otherDiam) / 2)) {
+                // The rectangles overlap --> Is either body on screen?
+                // Zoomed out too far     --> Accurate collision detection not important, good enough
+                // Both off screen        --> Good enough
+                // One or both on screen  --> Further checks
+                if (scale > 0.3
+                        && (body->isWithin(visibleRegion) || (*iter)->isWithin(visibleRegion))) {
+                    // On screen --> Check if sprites overlap
+                    if (spritesOverlap(body, *iter)) {
+                        collisions.push_back(*iter);
+                    }
+                } else {
+                    collisions.push_back(*iter);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief SpriteCollisionDetector::spritesOverlap Checks whether the sprites
+ * of the two bodies overlap, as they would be drawn on screen.
+ * @param b1 The first body
+ * @param b2 The second body
+ * @return True if any non-transparent pixels of the two sprites overlap
+ */
+bool SpriteCollisionDetector::spritesOverlap(Body *b1, Body *b2) {
+    int imgWidth, imgHeight;
+    double x1, x2, y1, y2, minX, minY;
+    double b1X = b1->getX(), b1Y = b1->getY(), b1Diam = b1->getDiameter();
+    double b2X = b2->getX(), b2Y = b2->getY(), b2Diam = b2->getDiameter();
+    QPixmap sprite1, sprite2;
+    QImage spriteImage1, spriteImage2;
+
+    // Get the sprites of the bodies
+    // Only the idle sprite of the rocket is considered (fire from the engines does not collide)
+    if (b1->getType() == Body::PlayerRocket) {
+        sprite1 = sprites.rocketIdleImage;
+        sprite2 = sprites.getImage(b2);
+    } else if (b2->getType() == Body::PlayerRocket) {
+        sprite1 = sprites.getImage(b1);
+        sprite2 = sprites.rocketIdleImage;
+    } else {
+        sprite1 = sprites.getImage(b1);
+        sprite2 = sprites.getImage(b2);
+    }
+    // Resize the sprites so they're as big as they are on screen
+    sprite1 = sprite1.scaled(static_cast<int>(b1Diam * scale),
+                             static_cast<int>(b1Diam * scale));
+    sprite2 = sprite2.scaled(static_cast<int>(b2Diam * scale),
+                             static_cast<int>(b2Diam * scale));
+
+    // Image big enough for just the overlapping parts
+    // One body's origin will be in one corner, the other in the opposite
+    imgWidth = static_cast<int>(scale * fabs((b1X - b2X)));
+    if (imgWidth <= 0) imgWidth = 1;
+    imgHeight = static_cast<int>(scale * fabs((b1Y - b2Y)));
+    if (imgHeight <= 0) imgHeight = 1;
+
+    // The sprite images are QImages with the cropped and correctly placed sprites,
+    // with any leftover background set to transparent
+    // The sprite images are then combined (into spriteImage1) using
+    // QPainter::CompositionMode_SourceIn to only display overlapping parts of the images
+    spriteImage1 = QImage(imgWidth, imgHeight, QImage::Format_ARGB32);
+    spriteImage1.fill(QColor(0,0,0,0));
+    spriteImage2 = QImage(imgWidth, imgHeight, QImage::Format_ARGB32);
+    spriteImage2.fill(QColor(0,0,0,0));
+
+    // Minimums will be the coordinates of the top left of the image
+    // Taking away the minimums from the bodies' coordinates will produce
+    // their correct new coordinates for the overlap image
+    minX = fmin(b1X, b2X);
+    minY = fmin(b1Y, b2Y);
+    // Calculate the coordinates where the images need to be drawn
+    x1 = scale * (b1X - minX);
+    y1 = scale * (b1Y - minY);
+    x2 = scale * (b2X - minX);
+    y2 = scale * (b2Y - minY);
+
+    // Draw sprites into the spriteImages
+    QPainter p1(&spriteImage1);
+    // If we are drawing a rocket we need to rotate it to the correct angle
+    if (b1->getType() == Body::PlayerRocket) {
+        // Save state of the painter
+        p1.save();
+        // Move the painter to where the rocket is going to be drawn
+        // (Want the centre of rotation to be the centre of the rocket)
+        p1.translate(x1, y1);
+        p1.rotate(static_cast<Rocket*>(b1)->getAngle());
+        p1.drawImage(static_cast<int>(-scale * (b1Diam / 2.0)),
+                     static_cast<int>(-scale * (b1Diam / 2.0)),
+                     sprite1.toImage());
+        // Restore state of the painter
+        p1.restore();
+    } else {
+        p1.drawImage(static_cast<int>(x1 - scale * (b1Diam / 2.0)),
+                     static_cast<int>(y1 - scale * (b1Diam / 2.0)),
+                     sprite1.toImage());
+    }
+
+    QPainter p2(&spriteImage2);
+    if (b2->getType() == Body::PlayerRocket) {
+        p2.save();
+        p2.translate(x2, y2);
+        p2.rotate(static_cast<Rocket*>(b2)->getAngle());
+        p2.drawImage(static_cast<int>(-scale * (b2Diam / 2.0)),
+                     static_cast<int>(-scale * (b2Diam / 2.0)),
+                     sprite2.toImage());
+        p2.restore();
+    } else {
+        p2.drawImage(static_cast<int>(x2 - scale * (b2Diam / 2.0)),
+                     static_cast<int>(y2 - scale * (b2Diam / 2.0)),
+                     sprite2.toImage());
+    }
+    // Draw the spriteImages on top of each other and find any overlap
+    p1.setCompositionMode(QPainter::CompositionMode_SourceIn);
+    p1.drawImage(0, 0, spriteImage2);
+
+    uchar *line;
+    QRgb pixel;
+    // Scan through the image, if any pixels are not ARGB=00000000 then there was
+    // some overlap --> collision has occurred
+    for (int i = 0, height = spriteImage1.height(); i < height; i++) {
+        // Look at each line
+        line = (spriteImage1.scanLine(i));
+        for (int j = 0, width = spriteImage1.width(); j < width; j++) {
+            // Look at each pixel in line
+            pixel = static_cast<QRgb>(line[static_cast<unsigned int>(j) * sizeof (QRgb)]);
+            if (pixel != qRgba(0,0,0,0)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief SpriteCollisionDetector::getName
+ * @return The name of the collision detector
+ */
+const char* SpriteCollisionDetector::getName() {
+    return "Sprite overlap";
+}
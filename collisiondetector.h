@@ -0,0 +1,48 @@
+#ifndef COLLISIONDETECTOR_H
+#define COLLISIONDETECTOR_H
+
+#include <vector>
+#include <QRect>
+#include "body.h"
+#include "sprites.h"
+#include "arena.h"
+
+// Bodies found to be colliding, allocated from the calling thread's Arena
+typedef std::vector<Body*, ArenaAllocator<Body*> > CollisionList;
+
+/*
+ * Interface for finding which bodies in the simulation are colliding.
+ * prepare() is called once at the start of each tick, then findCollisions()
+ * is called for every active body. findCollisions() may be called from
+ * several threads at once, so it must not change any of the bodies.
+ */
+class CollisionDetector {
+public:
+    virtual ~CollisionDetector();
+    virtual void prepare(std::vector<Body*> &bodies, QRect visibleRegion, double scale);
+    virtual void findCollisions(Body *body, std::vector<Body*> &bodies, CollisionList &collisions) = 0;
+    virtual const char* getName() = 0;
+
+protected:
+    QRect visibleRegion; // Area visible to the player
+    double scale = 1; // Matches SimulationWidget's scale
+};
+
+/*
+ * Reference collision detector. Checks every pair of bodies, first with
+ * cheap bounding box checks, then by checking whether the bodies' sprites
+ * overlap if either body is on screen.
+ */
+class SpriteCollisionDetector : public CollisionDetector {
+public:
+    SpriteCollisionDetector(Sprites sprites);
+    void findCollisions(Body *body, std::vector<Body*> &bodies, CollisionList &collisions) override;
+    const char* getName() override;
+
+private:
+    bool spritesOverlap(Body *b1, Body *b2);
+
+    Sprites sprites;
+};
+
+#endif // COLLISIONDETECTOR_H
@@ -0,0 +1,150 @@
+#include <cstring>
+#include <algorithm>
+#include "exploredmap.h"
+
+/**
+ * @brief ExploredMap::clear Marks every cell as unexplored.
+ */
+void ExploredMap::clear() {
+    tiles.clear();
+    dirtyTiles.clear();
+    allDirty = true;
+}
+
+/**
+ * @brief ExploredMap::fill Marks every cell in the given rectangle as
+ * explored. Only the tiles the rectangle covers are touched.
+ * @param cells The cells to mark
+ */
+void ExploredMap::fill(QRect cells) {
+    if (cells.isEmpty()) return;
+    int left = cells.left(), right = cells.left() + cells.width();
+    int top = cells.top(), bottom = cells.top() + cells.height();
+    for (int tileY = tileOf(top); tileY <= tileOf(bottom - 1); tileY++) {
+        for (int tileX = tileOf(left); tileX <= tileOf(right - 1); tileX++) {
+            std::unordered_map<uint64_t, Tile>::iterator found = tiles.find(tileKey(tileX, tileY));
+            if (found == tiles.end()) {
+                Tile empty;
+                memset(empty.rows, 0, sizeof(empty.rows));
+                found = tiles.insert(std::make_pair(tileKey(tileX, tileY), empty)).first;
+            }
+            Tile &tile = found->second;
+            // Part of the rectangle inside this tile, relative to the tile
+            int x0 = std::max(left - tileX * EXPLORED_TILE_SIZE, 0);
+            int x1 = std::min(right - tileX * EXPLORED_TILE_SIZE, EXPLORED_TILE_SIZE);
+            int y0 = std::max(top - tileY * EXPLORED_TILE_SIZE, 0);
+            int y1 = std::min(bottom - tileY * EXPLORED_TILE_SIZE, EXPLORED_TILE_SIZE);
+            uint64_t mask = (x1 - x0 == 64 ? ~0ULL : ((1ULL << (x1 - x0)) - 1)) << x0;
+            bool changed = false;
+            for (int y = y0; y < y1; y++) {
+                if ((tile.rows[y] & mask) != mask) changed = true;
+                tile.rows[y] |= mask;
+            }
+            if (changed) dirtyTiles.insert(tileKey(tileX, tileY));
+        }
+    }
+}
+
+/**
+ * @brief ExploredMap::isExplored Finds whether the given cell has been explored.
+ * @param x x-coordinate of the cell
+ * @param y y-coordinate of the cell
+ * @return True if the cell has been explored
+ */
+bool ExploredMap::isExplored(int x, int y) {
+    int tileX = tileOf(x), tileY = tileOf(y);
+    std::unordered_map<uint64_t, Tile>::iterator found = tiles.find(tileKey(tileX, tileY));
+    if (found == tiles.end()) return false;
+    return (found->second.rows[y - tileY * EXPLORED_TILE_SIZE] >> (x - tileX * EXPLORED_TILE_SIZE)) & 1;
+}
+
+/**
+ * @brief ExploredMap::toImage Draws the given area of the map, with one pixel
+ * per cell. Explored cells are blue and unexplored cells are white.
+ * @param cells The cells to draw
+ * @return An image of the map, the same size as cells
+ */
+QImage ExploredMap::toImage(QRect cells) {
+    QImage image(cells.size(), QImage::Format_ARGB32_Premultiplied);
+    image.fill(QColor(255, 255, 255));
+    if (cells.isEmpty()) return image;
+    QRgb explored = qRgb(0, 0, 255);
+    int left = cells.left(), right = cells.left() + cells.width();
+    int top = cells.top(), bottom = cells.top() + cells.height();
+    for (int tileY = tileOf(top); tileY <= tileOf(bottom - 1); tileY++) {
+        for (int tileX = tileOf(left); tileX <= tileOf(right - 1); tileX++) {
+            std::unordered_map<uint64_t, Tile>::iterator found = tiles.find(tileKey(tileX, tileY));
+            // Nothing explored in this tile
+            if (found == tiles.end()) continue;
+            Tile &tile = found->second;
+            int x0 = std::max(left - tileX * EXPLORED_TILE_SIZE, 0);
+            int x1 = std::min(right - tileX * EXPLORED_TILE_SIZE, EXPLORED_TILE_SIZE);
+            int y0 = std::max(top - tileY * EXPLORED_TILE_SIZE, 0);
+            int y1 = std::min(bottom - tileY * EXPLORED_TILE_SIZE, EXPLORED_TILE_SIZE);
+            for (int y = y0; y < y1; y++) {
+                uint64_t row = tile.rows[y];
+                if (!row) continue;
+                QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(tileY * EXPLORED_TILE_SIZE + y - top));
+                for (int x = x0; x < x1; x++) {
+                    if ((row >> x) & 1) line[tileX * EXPLORED_TILE_SIZE + x - left] = explored;
+                }
+            }
+        }
+    }
+    return image;
+}
+
+/**
+ * @brief ExploredMap::getTile Copies the cells of one tile.
+ * @param tileX x-coordinate of the tile
+ * @param tileY y-coordinate of the tile
+ * @param rows Filled with one row of the tile per word, lowest bit leftmost
+ * @return False if nothing in the tile has been explored
+ */
+bool ExploredMap::getTile(int tileX, int tileY, uint64_t rows[EXPLORED_TILE_SIZE]) {
+    std::unordered_map<uint64_t, Tile>::iterator found = tiles.find(tileKey(tileX, tileY));
+    if (found == tiles.end()) {
+        memset(rows, 0, sizeof(uint64_t) * EXPLORED_TILE_SIZE);
+        return false;
+    }
+    memcpy(rows, found->second.rows, sizeof(found->second.rows));
+    return true;
+}
+
+/**
+ * @brief ExploredMap::takeDirtyTiles Gets the tiles with cells explored since
+ * the last call, so that anything drawn from the map only has to redraw them.
+ * @param dirty Filled with the positions of the changed tiles
+ * @return True if the map has been cleared since the last call, so
+ * everything drawn from it must be redrawn
+ */
+bool ExploredMap::takeDirtyTiles(std::vector<QPoint> &dirty) {
+    dirty.clear();
+    for (std::unordered_set<uint64_t>::iterator iter = dirtyTiles.begin(), end = dirtyTiles.end(); iter != end; ++iter) {
+        dirty.push_back(QPoint(static_cast<int32_t>(*iter >> 32), static_cast<int32_t>(*iter & 0xffffffff)));
+    }
+    dirtyTiles.clear();
+    bool cleared = allDirty;
+    allDirty = false;
+    return cleared;
+}
+
+/**
+ * @brief ExploredMap::tileOf Returns which tile the given cell coordinate is
+ * in, rounding down for negative coordinates.
+ * @param cell x or y-coordinate of a cell
+ * @return x or y-coordinate of the tile
+ */
+int ExploredMap::tileOf(int cell) {
+    return cell >= 0 ? cell / EXPLORED_TILE_SIZE : (cell + 1) / EXPLORED_TILE_SIZE - 1;
+}
+
+/**
+ * @brief ExploredMap::tileKey Packs the position of a tile into one value.
+ * @param tileX x-coordinate of the tile
+ * @param tileY y-coordinate of the tile
+ * @return A value unique to the tile
+ */
+uint64_t ExploredMap::tileKey(int tileX, int tileY) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(tileX)) << 32) | static_cast<uint32_t>(tileY);
+}
@@ -0,0 +1,44 @@
+#ifndef EXPLOREDMAP_H
+#define EXPLOREDMAP_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <QImage>
+#include <QRect>
+
+// Width and height of each tile of the map, in cells. One bit per cell
+#define EXPLORED_TILE_SIZE 64
+
+/*
+ * Map of which cells of the universe have been explored. Only tiles with an
+ * explored cell are stored, one bit per cell, so the map can cover any area
+ * without growing or copying. Not thread safe.
+ */
+class ExploredMap {
+public:
+    void clear();
+    void fill(QRect cells);
+    bool isExplored(int x, int y);
+    QImage toImage(QRect cells);
+    bool getTile(int tileX, int tileY, uint64_t rows[EXPLORED_TILE_SIZE]);
+    bool takeDirtyTiles(std::vector<QPoint> &dirty);
+
+private:
+    // One row of the tile per word, lowest bit leftmost
+    struct Tile {
+        uint64_t rows[EXPLORED_TILE_SIZE];
+    };
+
+    static int tileOf(int cell);
+    static uint64_t tileKey(int tileX, int tileY);
+
+    std::unordered_map<uint64_t, Tile> tiles;
+    // Tiles with cells explored since the last takeDirtyTiles()
+    std::unordered_set<uint64_t> dirtyTiles;
+    // Has the map been cleared since the last takeDirtyTiles()?
+    bool allDirty = true;
+};
+
+#endif // EXPLOREDMAP_H
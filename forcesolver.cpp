@@ -0,0 +1,75 @@
+#include <cmath>
+#include "forcesolver.h"
+
+/**
+ * @brief ForceSolver::~ForceSolver Destructor.
+ */
+ForceSolver::~ForceSolver() {}
+
+/**
+ * @brief ForceSolver::prepare Called once at the start of each tick, before
+ * any forces are applied. Solvers which need to build any structures from
+ * the bodies (e.g. a tree) should do so here. Does nothing by default.
+ * @param bodies All bodies in the simulation
+ */
+void ForceSolver::prepare(std::vector<Body*> &) {}
+
+/**
+ * @brief BruteForceSolver::applyForces Calculates the gravitational force
+ * exerted on the given body by every other active body and updates the
+ * body's velocity accordingly.
+ * @param body The body to update the velocity of
+ * @param bodies All bodies in the simulation
+ * @param G The gravitational constant
+ */
+void BruteForceSolver::applyForces(Body *body, std::vector<Body*> &bodies, double G) {
+    // Create some frequently used variables
+    Vector v;
+    Vector *pos = body->getPos(), *otherPos, *otherPosCopy = &v;
+    double x = pos->getX(), y = pos->getY(), mass = body->getMass();
+    double otherX, otherY, otherMass, massRatio, sqDist, dist;
+    for (std::vector<Body*>::iterator iter = bodies.begin(), end = bodies.end(); iter != end; ++iter) {
+        // Make sure the two bodies are not the same and that the other body is active
+        if (*iter == body || !(*iter)->isActive()) continue;
+        otherPos = (*iter)->getPos();
+        otherX = otherPos->getX();
+        otherY = otherPos->getY();
+        // Are the bodies even remotely close to each other?
+        if (fabs(x - otherX) + fabs(y - otherY) < FORCE_CUTOFF_DISTANCE) {
+            // Some optimisations to make sure it's worthwhile to calculate the gravitational forces
+            // At very large distances the force is negligible
+            otherMass = (*iter)->getMass();
+            // If body is a star and the other body is an asteroid, the force put on body is
+            // probably negligible and probably not worth calculating, so want the ratio
+            // to be smaller when body is larger
+            massRatio = otherMass / mass;
+            // If body is NOT massively larger than the other body, continue
+            if (massRatio > FORCE_MIN_MASS_RATIO) {
+                sqDist = pos->squareDist(otherPos);
+                // If the two bodies are relatively close, continue
+                if (sqDist < FORCE_CUTOFF_SQ_DISTANCE) {
+                    // Calculate gravitational force exerted on body and update velocity
+                    // vel += (G * mass2 * (pos2 - pos 1)) / (dist ^ 3)
+                    // Converted to my Vector notation:
+                    // vel += (pos2 - po1).scale(G * mass2 / (dist ^ 3))
+                    dist = otherPos->distance(pos);
+                    if (dist < 1) dist = 1;
+                    otherPosCopy->set(otherPos);
+                    body->getVel()->add( // Add following to current velocity
+                        (otherPosCopy->sub(pos))->scale( // (pos2 - pos1) scaled by
+                            G * otherMass / // G * mass2 divided by
+                                pow(dist, 3)) // (dist^3)
+                    );
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief BruteForceSolver::getName
+ * @return The name of the solver
+ */
+const char* BruteForceSolver::getName() {
+    return "Brute force";
+}
@@ -0,0 +1,121 @@
+#ifndef FORCESOLVER_H
+#define FORCESOLVER_H
+
+#include <vector>
+#include <cmath>
+#include "body.h"
+
+// Pairs of bodies further apart than this in x plus y don't pull on each other
+#define FORCE_CUTOFF_DISTANCE 2000
+// Nor do pairs further apart than the square root of this
+#define FORCE_CUTOFF_SQ_DISTANCE 1000000
+// Bodies lighter than this fraction of a body's mass don't pull on it
+#define FORCE_MIN_MASS_RATIO 0.001
+
+/*
+ * Interface for calculating the gravitational forces acting on the bodies
+ * in the simulation. prepare() is called once at the start of each tick,
+ * then applyForces() is called for every active body. applyForces() may be
+ * called from several threads at once, so it must only change the velocity
+ * of the body it is given.
+ */
+class ForceSolver {
+public:
+    virtual ~ForceSolver();
+    virtual void prepare(std::vector<Body*> &bodies);
+    virtual void applyForces(Body *body, std::vector<Body*> &bodies, double G) = 0;
+    virtual const char* getName() = 0;
+};
+
+/*
+ * Reference solver. Calculates the force exerted on a body by every other
+ * body directly, skipping any pairs where the force would be negligible.
+ */
+class BruteForceSolver : public ForceSolver {
+public:
+    void applyForces(Body *body, std::vector<Body*> &bodies, double G) override;
+    const char* getName() override;
+};
+
+/*
+ * Same forces as BruteForceSolver, but the positions and masses of all bodies
+ * are first packed into contiguous arrays of type Scalar. The inner loop has
+ * no branches so that the compiler can vectorise it; with Scalar = float
+ * twice as many bodies fit into each SIMD register and half as much memory
+ * is read per body. Positions are relative to the simulation's origin, which
+ * is rebased to stay near the player, so float is precise enough.
+ */
+template <typename Scalar>
+class PackedForceSolver : public ForceSolver {
+public:
+    void prepare(std::vector<Body*> &bodies) override;
+    void applyForces(Body *body, std::vector<Body*> &bodies, double G) override;
+    const char* getName() override;
+
+private:
+    std::vector<Scalar> xs;
+    std::vector<Scalar> ys;
+    std::vector<Scalar> masses;
+};
+
+/**
+ * @brief PackedForceSolver::prepare Packs the positions and masses of all
+ * active bodies into the solver's arrays. The arrays keep their capacity
+ * between ticks, so nothing is allocated once the number of bodies settles.
+ * @param bodies All bodies in the simulation
+ */
+template <typename Scalar>
+void PackedForceSolver<Scalar>::prepare(std::vector<Body*> &bodies) {
+    xs.clear();
+    ys.clear();
+    masses.clear();
+    for (std::vector<Body*>::iterator iter = bodies.begin(), end = bodies.end(); iter != end; ++iter) {
+        if (!(*iter)->isActive()) continue;
+        xs.push_back(static_cast<Scalar>((*iter)->getX()));
+        ys.push_back(static_cast<Scalar>((*iter)->getY()));
+        masses.push_back(static_cast<Scalar>((*iter)->getMass()));
+    }
+}
+
+/**
+ * @brief PackedForceSolver::applyForces Calculates the gravitational force
+ * exerted on the given body by every packed body and updates the body's
+ * velocity accordingly. The body's own entry contributes no force since
+ * its distance vector is zero.
+ * @param body The body to update the velocity of
+ * @param bodies All bodies in the simulation (unused, see prepare())
+ * @param G The gravitational constant
+ */
+template <typename Scalar>
+void PackedForceSolver<Scalar>::applyForces(Body *body, std::vector<Body*> &, double G) {
+    const Scalar x = static_cast<Scalar>(body->getX());
+    const Scalar y = static_cast<Scalar>(body->getY());
+    // Bodies lighter than this have a negligible pull on this body
+    const Scalar minMass = static_cast<Scalar>(FORCE_MIN_MASS_RATIO * body->getMass());
+    const Scalar g = static_cast<Scalar>(G);
+    const Scalar *px = xs.data(), *py = ys.data(), *pm = masses.data();
+    Scalar velX = 0, velY = 0, dx, dy, sqDist, dist, f;
+    for (size_t i = 0, n = xs.size(); i < n; i++) {
+        dx = px[i] - x;
+        dy = py[i] - y;
+        sqDist = dx * dx + dy * dy;
+        dist = std::sqrt(sqDist < 1 ? Scalar(1) : sqDist);
+        // vel += (G * mass2 * (pos2 - pos 1)) / (dist ^ 3), ignoring bodies
+        // which are far away or much lighter, as BruteForceSolver does
+        f = (sqDist < FORCE_CUTOFF_SQ_DISTANCE && pm[i] > minMass) ? g * pm[i] / (dist * dist * dist) : Scalar(0);
+        velX += dx * f;
+        velY += dy * f;
+    }
+    body->getVel()->add(velX, velY);
+}
+
+/**
+ * @brief PackedForceSolver::getName
+ * @return The name of the solver, including the precision it uses
+ */
+template <typename Scalar>
+const char* PackedForceSolver<Scalar>::getName() {
+    return sizeof(Scalar) == sizeof(float) ? "Packed (single precision)" : "Packed (double precision)";
+}
+
+#endif // FORCESOLVER_H
@@ -0,0 +1,258 @@
+#include <iostream>
+#include <algorithm>
+#include <QDir>
+#include "frameexporter.h"
+
+// Frames between progress messages
+#define PROGRESS_INTERVAL 60
+
+/**
+ * @brief FrameExporter::FrameExporter Prepares to record the given simulation.
+ * Nothing happens until run() is called.
+ * @param sim The simulation to record. Should be paused, so that it is only
+ * moved on by the exporter
+ * @param sprites The sprites to draw bodies with
+ * @param settings Where and how to record the simulation
+ */
+FrameExporter::FrameExporter(Simulation *sim, Sprites sprites, const Settings &settings) {
+    this->sim = sim;
+    this->settings = settings;
+    renderer = new Renderer(sprites);
+}
+
+/**
+ * @brief FrameExporter::~FrameExporter Destructor.
+ */
+FrameExporter::~FrameExporter() {
+    delete renderer;
+}
+
+/**
+ * @brief FrameExporter::run Records the simulation, returning once every
+ * frame has been written. While the renderer draws one frame, the simulation
+ * is stepped on to the next, and the encoders write the frames before.
+ * @return False if the output couldn't be written
+ */
+bool FrameExporter::run() {
+    if (settings.width <= 0 || settings.height <= 0 || settings.frames <= 0 || settings.ticksPerFrame <= 0) {
+        std::cerr << "Frame size, number of frames and ticks per frame must be positive" << std::endl;
+        return false;
+    }
+    if (settings.format == Y4m) {
+        if (settings.width % 2 || settings.height % 2) {
+            std::cerr << "Y4M frames must have an even width and height" << std::endl;
+            return false;
+        }
+        file = fopen(settings.output.c_str(), "wb");
+        if (!file) {
+            std::cerr << "Couldn't open " << settings.output << std::endl;
+            return false;
+        }
+        fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", settings.width, settings.height, settings.fps);
+    } else if (!QDir().mkpath(QString::fromStdString(settings.output))) {
+        std::cerr << "Couldn't create " << settings.output << std::endl;
+        return false;
+    }
+
+    int numEncoders = settings.encoderThreads;
+    if (numEncoders <= 0) numEncoders = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+    for (int i = 0; i < numEncoders; i++) {
+        encoders.push_back(std::thread(&FrameExporter::encode, this));
+    }
+
+    Renderer::View view;
+    view.width = settings.width;
+    view.height = settings.height;
+    view.scale = settings.scale;
+    view.backgroundScale = (settings.scale + 4) / 5;
+    Rocket rocket;
+    std::shared_ptr<Simulation::Snapshot> snapshot = sim->getSnapshot();
+    QPointF origin = snapshot->origin;
+    for (int i = 0; i <= settings.frames; i++) {
+        QImage image;
+        if (i < settings.frames) {
+            // Move the simulation on to this frame while the last is drawn
+            double left = settings.centre.x() - origin.x() - settings.width / 2.0 / settings.scale;
+            double top = settings.centre.y() - origin.y() - settings.height / 2.0 / settings.scale;
+            sim->setVisibleRegion(left, top, settings.width / settings.scale, settings.height / settings.scale,
+                                  settings.scale, origin);
+            for (int tick = 0; i > 0 && tick < settings.ticksPerFrame; tick++) {
+                sim->step();
+            }
+            snapshot = sim->getSnapshot();
+            origin = snapshot->origin;
+        }
+        if (i > 0) {
+            // Queue the last frame to be encoded, waiting if the queue is full
+            mut.lock();
+            if (!freeImages.empty()) {
+                image.swap(freeImages.back());
+                freeImages.pop_back();
+            }
+            mut.unlock();
+            renderer->waitForFrame(image);
+            std::unique_lock<std::mutex> lock(mut);
+            jobTaken.wait(lock, [this] { return static_cast<int>(jobs.size()) < settings.queueLength || failed; });
+            if (failed) break;
+            Job job;
+            job.index = i - 1;
+            job.image.swap(image);
+            jobs.push_back(job);
+            lock.unlock();
+            jobQueued.notify_one();
+            if (i % PROGRESS_INTERVAL == 0 || i == settings.frames) {
+                std::cout << "Exported " << i << " / " << settings.frames << " frames" << std::endl;
+            }
+        }
+        if (i < settings.frames) {
+            view.left = settings.centre.x() - origin.x() - settings.width / 2.0 / settings.scale;
+            view.top = settings.centre.y() - origin.y() - settings.height / 2.0 / settings.scale;
+            renderer->requestFrame(snapshot, rocket, view);
+        }
+    }
+
+    // Let the encoders finish the queue, then stop them
+    mut.lock();
+    finished = true;
+    mut.unlock();
+    jobQueued.notify_all();
+    for (std::vector<std::thread>::iterator iter = encoders.begin(), end = encoders.end(); iter != end; ++iter) {
+        iter->join();
+    }
+    encoders.clear();
+    if (file) {
+        if (fclose(file) != 0) fail("Couldn't finish writing " + settings.output);
+        file = nullptr;
+    }
+    return !failed;
+}
+
+/**
+ * @brief FrameExporter::encode An encoder thread. Takes frames from the queue
+ * and writes them until the queue is empty and run() has finished.
+ */
+void FrameExporter::encode() {
+    std::vector<unsigned char> data;
+    std::unique_lock<std::mutex> lock(mut);
+    while (true) {
+        jobQueued.wait(lock, [this] { return !jobs.empty() || finished; });
+        if (jobs.empty()) return;
+        Job job = jobs.front();
+        jobs.pop_front();
+        lock.unlock();
+        jobTaken.notify_one();
+
+        if (settings.format == Y4m) {
+            convertToY4m(job.image, data);
+            writeY4m(job.index, data);
+        } else {
+            writePng(job);
+        }
+
+        lock.lock();
+        // Keep a few images to draw later frames into
+        if (static_cast<int>(freeImages.size()) < settings.queueLength) {
+            freeImages.push_back(QImage());
+            freeImages.back().swap(job.image);
+        }
+    }
+}
+
+/**
+ * @brief FrameExporter::writePng Writes a frame as the PNG file for its
+ * position in the sequence.
+ * @param job The frame
+ * @return False if the file couldn't be written
+ */
+bool FrameExporter::writePng(const Job &job) {
+    char name[32];
+    snprintf(name, sizeof(name), "/frame_%06d.png", job.index);
+    std::string path = settings.output + name;
+    if (!job.image.save(QString::fromStdString(path), "PNG")) {
+        fail("Couldn't write " + path);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief FrameExporter::convertToY4m Converts a frame to full range YUV 4:2:0,
+ * as planes of Y, then U, then V. Each U and V sample is the average of a
+ * 2x2 block of pixels.
+ * @param image The frame, an opaque ARGB32 image
+ * @param data Filled with the converted frame
+ */
+void FrameExporter::convertToY4m(const QImage &image, std::vector<unsigned char> &data) {
+    int width = image.width(), height = image.height();
+    size_t lumaSize = static_cast<size_t>(width * height);
+    size_t chromaSize = lumaSize / 4;
+    data.resize(lumaSize + chromaSize * 2);
+    unsigned char *yPlane = &data[0];
+    unsigned char *uPlane = yPlane + lumaSize;
+    unsigned char *vPlane = uPlane + chromaSize;
+    for (int y = 0; y < height; y += 2) {
+        const QRgb *line0 = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        const QRgb *line1 = reinterpret_cast<const QRgb*>(image.constScanLine(y + 1));
+        for (int x = 0; x < width; x += 2) {
+            QRgb pixels[4] = {line0[x], line0[x + 1], line1[x], line1[x + 1]};
+            int r = 0, g = 0, b = 0;
+            for (int i = 0; i < 4; i++) {
+                int pr = qRed(pixels[i]), pg = qGreen(pixels[i]), pb = qBlue(pixels[i]);
+                // BT.601 weights in 8 bit fixed point
+                yPlane[(y + i / 2) * width + x + i % 2] = static_cast<unsigned char>((77 * pr + 150 * pg + 29 * pb + 128) >> 8);
+                r += pr;
+                g += pg;
+                b += pb;
+            }
+            r = (r + 2) / 4;
+            g = (g + 2) / 4;
+            b = (b + 2) / 4;
+            // Offset by 128 << 8 so the sums are never negative
+            int u = (-43 * r - 85 * g + 128 * b + 32896) >> 8;
+            int v = (128 * r - 107 * g - 21 * b + 32896) >> 8;
+            size_t chroma = static_cast<size_t>((y / 2) * (width / 2) + x / 2);
+            uPlane[chroma] = static_cast<unsigned char>(std::min(u, 255));
+            vPlane[chroma] = static_cast<unsigned char>(std::min(v, 255));
+        }
+    }
+}
+
+/**
+ * @brief FrameExporter::writeY4m Writes a converted frame to the video once
+ * every frame before it has been written, along with any later frames which
+ * were waiting for it.
+ * @param index Position of the frame in the video
+ * @param data The converted frame. Taken, leaving it empty
+ * @return False if the frame couldn't be written
+ */
+bool FrameExporter::writeY4m(int index, std::vector<unsigned char> &data) {
+    writeMut.lock();
+    converted[index].swap(data);
+    bool ok = true;
+    std::map<int, std::vector<unsigned char> >::iterator next = converted.find(nextToWrite);
+    while (next != converted.end()) {
+        if (fputs("FRAME\n", file) < 0 ||
+                fwrite(&next->second[0], 1, next->second.size(), file) != next->second.size()) {
+            ok = false;
+        }
+        converted.erase(next);
+        nextToWrite++;
+        next = converted.find(nextToWrite);
+    }
+    writeMut.unlock();
+    if (!ok) fail("Couldn't write to " + settings.output);
+    return ok;
+}
+
+/**
+ * @brief FrameExporter::fail Reports an error writing the output, and stops
+ * the export after the frames already queued.
+ * @param message What went wrong
+ */
+void FrameExporter::fail(const std::string &message) {
+    mut.lock();
+    if (!failed) std::cerr << message << std::endl;
+    failed = true;
+    mut.unlock();
+    jobTaken.notify_all();
+}
@@ -0,0 +1,95 @@
+#ifndef FRAMEEXPORTER_H
+#define FRAMEEXPORTER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>
+#include <QImage>
+#include "simulation.h"
+#include "renderer.h"
+
+/*
+ * Records a simulation to a video without a window. The simulation is
+ * stepped a fixed number of ticks per frame, as fast as the computer allows
+ * rather than in real time, and each frame is drawn offscreen by a Renderer
+ * at any resolution. Finished frames are queued for a pool of encoder
+ * threads, which write them as a sequence of PNGs or one raw Y4M video. The
+ * queue has a fixed length, so the simulation waits for the encoders rather
+ * than filling memory with frames.
+ */
+class FrameExporter {
+public:
+    enum Format {
+        PngSequence = 0, // frame_000000.png etc. in a directory
+        Y4m = 1          // Uncompressed YUV 4:2:0 video
+    };
+
+    struct Settings {
+        // Directory for a PNG sequence, or file for a Y4M video
+        std::string output;
+        Format format = PngSequence;
+        // Size of each frame in pixels. Y4M needs even sizes
+        int width = 1920;
+        int height = 1080;
+        int frames = 600;
+        // Ticks of the simulation between frames
+        int ticksPerFrame = 1;
+        // Frame rate written to the Y4M header
+        int fps = 60;
+        // Pixels per unit of distance, and world position at the centre of the frames
+        double scale = 1;
+        QPointF centre;
+        // Number of encoder threads, or 0 for one per core
+        int encoderThreads = 0;
+        // Most frames waiting to be encoded
+        int queueLength = 8;
+    };
+
+    FrameExporter(Simulation *sim, Sprites sprites, const Settings &settings);
+    ~FrameExporter();
+    bool run();
+
+private:
+    // A frame waiting to be encoded
+    struct Job {
+        int index;
+        QImage image;
+    };
+
+    void encode();
+    bool writePng(const Job &job);
+    void convertToY4m(const QImage &image, std::vector<unsigned char> &data);
+    bool writeY4m(int index, std::vector<unsigned char> &data);
+    void fail(const std::string &message);
+
+    Simulation *sim;
+    Renderer *renderer;
+    Settings settings;
+
+    std::vector<std::thread> encoders;
+    std::mutex mut;
+    // Signalled when a job is queued, or the encoders should stop
+    std::condition_variable jobQueued;
+    // Signalled when a job is taken from the queue
+    std::condition_variable jobTaken;
+    std::deque<Job> jobs;
+    bool finished = false;
+    // Images the encoders are done with, reused for later frames
+    std::vector<QImage> freeImages;
+    // Set if anything failed to be written
+    bool failed = false;
+
+    // Y4M frames can be converted in any order, but must be written in order.
+    // Converted frames wait here until it is their turn (guarded by writeMut)
+    std::mutex writeMut;
+    std::map<int, std::vector<unsigned char> > converted;
+    int nextToWrite = 0;
+    FILE *file = nullptr;
+};
+
+#endif // FRAMEEXPORTER_H
@@ -0,0 +1,23 @@
+#include "integrator.h"
+
+/**
+ * @brief Integrator::~Integrator Destructor.
+ */
+Integrator::~Integrator() {}
+
+/**
+ * @brief EulerIntegrator::integrate Moves the body by one step by adding its
+ * velocity to its position.
+ * @param body The body to move
+ */
+void EulerIntegrator::integrate(Body *body) {
+    body->move();
+}
+
+/**
+ * @brief EulerIntegrator::getName
+ * @return The name of the integrator
+ */
+const char* EulerIntegrator::getName() {
+    return "Euler";
+}
@@ -0,0 +1,28 @@
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+#include "body.h"
+
+/*
+ * Interface for advancing a body by one step once all forces acting on it
+ * have been applied to its velocity.
+ */
+class Integrator {
+public:
+    virtual ~Integrator();
+    virtual void integrate(Body *body) = 0;
+    virtual const char* getName() = 0;
+};
+
+/*
+ * Reference integrator. Velocities have already been updated by the force
+ * solver, so the position is simply moved by the new velocity
+ * (semi-implicit Euler).
+ */
+class EulerIntegrator : public Integrator {
+public:
+    void integrate(Body *body) override;
+    const char* getName() override;
+};
+
+#endif // INTEGRATOR_H
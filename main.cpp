@@ -1,3 +1,8 @@
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <random>
 #include <QtWidgets/QApplication>
 #include "rasterwindow.h"
 #include "analogclockwindow.h"
@@ -5,8 +10,187 @@
 #include "sprites.h"
 #include "simulation.h"
 #include "mainwindow.h"
+#include "frameexporter.h"
+#include "forcesolver.h"
+
+/**
+ * @brief printUsage Prints the command line options for exporting a video.
+ */
+static void printUsage() {
+    std::cout << "Usage: orbit-sandbox [--export PATH [options]]\n"
+                 "Records a sandbox simulation without opening a window. PATH is a directory for a\n"
+                 "PNG sequence, or a file ending in .y4m for an uncompressed video.\n"
+                 "  --frames N           Number of frames (default 600)\n"
+                 "  --size WxH           Frame size in pixels (default 1920x1080)\n"
+                 "  --ticks-per-frame N  Simulation ticks between frames (default 1)\n"
+                 "  --fps N              Frame rate of the video (default 60)\n"
+                 "  --scale S            Pixels per unit of distance (default 1)\n"
+                 "  --centre X,Y         World position at the centre of the frames (default 0,0)\n"
+                 "  --seed N             Seed of the universe (default random)\n"
+                 "  --systems N          Planetary systems to spawn around the centre (default 0)\n"
+                 "  --threads N          Encoder threads (default one per core)\n"
+                 "  --trails             Draw the paths of the bodies\n"
+                 "  --solver NAME        Gravity solver: brute, packed or packed-float (default brute)\n"
+                 "  --float              Calculate gravity in single precision (same as --solver packed-float)"
+              << std::endl;
+}
+
+/**
+ * @brief parseNumber Reads a whole command line value.
+ * @param text The value
+ * @param value Set to the number
+ * @return False if the value isn't a number
+ */
+static bool parseNumber(const char *text, double *value) {
+    char *end;
+    *value = strtod(text, &end);
+    return end != text && *end == '\0';
+}
+
+/**
+ * @brief runExport Records a simulation to a video as described by the
+ * command line, without opening a window.
+ * @param argc Number of command line arguments
+ * @param argv The command line arguments
+ * @return Exit code of the program
+ */
+static int runExport(int argc, char **argv) {
+    FrameExporter::Settings settings;
+    uint64_t seed = 0;
+    bool seeded = false;
+    int numSystems = 0;
+    bool trails = false;
+    // Null to keep the simulation's default solver
+    ForceSolver *solver = nullptr;
+    bool singlePrecision = false;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--trails") == 0) {
+            trails = true;
+            continue;
+        }
+        if (strcmp(arg, "--float") == 0) {
+            singlePrecision = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printUsage();
+            delete solver;
+            return 1;
+        }
+        const char *value = argv[++i];
+        double number = 0;
+        bool ok = true;
+        if (strcmp(arg, "--export") == 0) {
+            settings.output = value;
+            size_t length = settings.output.size();
+            if (length >= 4 && settings.output.compare(length - 4, 4, ".y4m") == 0) {
+                settings.format = FrameExporter::Y4m;
+            }
+        } else if (strcmp(arg, "--size") == 0) {
+            ok = sscanf(value, "%dx%d", &settings.width, &settings.height) == 2;
+        } else if (strcmp(arg, "--centre") == 0) {
+            double x, y;
+            ok = sscanf(value, "%lf,%lf", &x, &y) == 2;
+            settings.centre = QPointF(x, y);
+        } else if (strcmp(arg, "--seed") == 0) {
+            char *end;
+            seed = strtoull(value, &end, 10);
+            ok = end != value && *end == '\0';
+            seeded = true;
+        } else if (strcmp(arg, "--solver") == 0) {
+            delete solver;
+            solver = nullptr;
+            if (strcmp(value, "brute") == 0) {
+                solver = new BruteForceSolver();
+            } else if (strcmp(value, "packed") == 0) {
+                solver = new PackedForceSolver<double>();
+            } else if (strcmp(value, "packed-float") == 0) {
+                solver = new PackedForceSolver<float>();
+            } else {
+                ok = false;
+            }
+        } else if ((ok = parseNumber(value, &number))) {
+            if (strcmp(arg, "--frames") == 0) {
+                settings.frames = static_cast<int>(number);
+            } else if (strcmp(arg, "--ticks-per-frame") == 0) {
+                settings.ticksPerFrame = static_cast<int>(number);
+            } else if (strcmp(arg, "--fps") == 0) {
+                settings.fps = static_cast<int>(number);
+            } else if (strcmp(arg, "--scale") == 0) {
+                settings.scale = number;
+            } else if (strcmp(arg, "--systems") == 0) {
+                numSystems = static_cast<int>(number);
+            } else if (strcmp(arg, "--threads") == 0) {
+                settings.encoderThreads = static_cast<int>(number);
+            } else {
+                ok = false;
+            }
+        }
+        if (!ok) {
+            std::cerr << "Bad option: " << arg << " " << value << std::endl;
+            printUsage();
+            delete solver;
+            return 1;
+        }
+    }
+    if (settings.scale <= 0) {
+        std::cerr << "Scale must be positive" << std::endl;
+        delete solver;
+        return 1;
+    }
+
+    // The simulation stays paused, and is only stepped by the exporter
+    Sprites sprites;
+    Simulation *sim = new Simulation(sprites);
+    sim->setMode(Simulation::Sandbox);
+    if (!seeded) {
+        // Print the seed so the run can be repeated
+        std::random_device device;
+        seed = (static_cast<uint64_t>(device()) << 32) | device();
+        std::cout << "Seed: " << seed << std::endl;
+    }
+    sim->resetSim(seed);
+    // Systems are spawned around the centre of the visible region
+    double width = settings.width / settings.scale, height = settings.height / settings.scale;
+    sim->setVisibleRegion(settings.centre.x() - width / 2, settings.centre.y() - height / 2,
+                          width, height, settings.scale, QPointF(0, 0));
+    if (numSystems > 0) {
+        UniverseParams params;
+        params.numSystems = numSystems;
+        // The systems come from the simulation's seed, so the run can be repeated
+        sim->spawnUniverse(params);
+    }
+    sim->setTrailsEnabled(trails);
+    // Either is used from the first tick the exporter performs. The solver
+    // is printed so runs with different solvers can be told apart
+    if (singlePrecision) {
+        delete solver;
+        sim->setSinglePrecision(true);
+        std::cout << "Force solver: single precision" << std::endl;
+    } else if (solver) {
+        std::cout << "Force solver: " << solver->getName() << std::endl;
+        sim->setForceSolver(solver);
+    }
+
+    FrameExporter exporter(sim, sprites, settings);
+    return exporter.run() ? 0 : 1;
+}
 
 int main(int argc, char **argv) {
+    bool exporting = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--export") == 0) exporting = true;
+        if (strcmp(argv[i], "--help") == 0) {
+            printUsage();
+            return 0;
+        }
+    }
+    if (exporting) {
+        // No window is needed --> Don't need a display either
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
     /*
      * The entry point for a QWindow based application is the QGuiApplication class.
      * It manages the GUI application's control flow and main settings.
@@ -14,6 +198,10 @@ int main(int argc, char **argv) {
      */
     QApplication app(argc, argv);
 
+    if (exporting) {
+        return runExport(argc, argv);
+    }
+
     // RasterWindow window; // Initialise class
     //AnalogClockWindow window;
     MainWindow *window = new MainWindow();
@@ -5,6 +5,10 @@
 #define BUTTON_STYLE "QPushButton {background-color: #4f5154; color: white;}"
 
 #define SB_SELECTOR_WIDTH 60
+// Size and zoom of the zoomed out view in the corner of the exploration mode
+#define INSET_WIDTH 300
+#define INSET_HEIGHT 200
+#define INSET_SCALE 0.2
 
 MainWindow::MainWindow() {
     sprites = new Sprites();
@@ -394,6 +398,14 @@ void MainWindow::createExplorationMode() {
     });
     exHomeButton->move(width() - 55, height() - 53);
 
+    // Zoomed out view around the rocket (hidden until V is pressed). Draws
+    // the same snapshot of the simulation as the main view, with its own camera
+    exInset = new SimulationWidget(sim, *sprites, false);
+    exInset->setParent(exContainer);
+    exInset->setGeometry(width() - INSET_WIDTH - 5, 5, INSET_WIDTH, INSET_HEIGHT);
+    exInset->setZoom(INSET_SCALE);
+    exInset->hide();
+
     // Game over text
     QString str("GAME OVER");
     QFontMetrics fm(*titleFont);
@@ -474,7 +486,8 @@ void MainWindow::createControlsScreen() {
     csSandboxText = new QLabel("In the right bar, click on the icon of the type of body you want to spawn (default asteroid). "
                                "Hover over the icon to find out about the properties of that particular body. "
                                "Once you have chosen your celestial body, click and drag on the screen to spawn and fling it. "
-                               "The further you drag, the greater the body's velocity as it spawns.");
+                               "The further you drag, the greater the body's velocity as it spawns. "
+                               "Press T to show or hide the paths the bodies have taken.");
     csSandboxText->setWordWrap(true);
     csSandboxText->setMinimumHeight(120);
     csvSandboxLayout->addWidget(csSandboxText, 0, Qt::AlignCenter);
@@ -490,7 +503,9 @@ void MainWindow::createControlsScreen() {
     csExplorationText = new QLabel("In the Exploration mode you control a rocket, placed in the centre of the screen. Press and "
                                    "hold W to fire the rocket's engines and increase your velocity in the direction you are facing. "
                                    "Use the A and D keys to rotate the rocket anti-clockwise and clockwise respectively. Fly the "
-                                   "rocket around to explore the procedurally generated universe, but try not to crash!");
+                                   "rocket around to explore the procedurally generated universe, but try not to crash! "
+                                   "Press T to show or hide the paths the bodies have taken, and V to show or hide a "
+                                   "zoomed out view around the rocket.");
     csExplorationText->setWordWrap(true);
     csExplorationText->setMinimumHeight(120);
     csvExplorationLayout->addWidget(csExplorationText, 0, Qt::AlignCenter);
@@ -629,6 +644,7 @@ void MainWindow::resizeEvent(QResizeEvent *event) {
         simWidget->resize(event->size());
     } else if (mode == Exploration) {
         exHomeButton->move(width() - 55, height() - 53);
+        exInset->move(width() - INSET_WIDTH - 5, 5);
         exGameOver->move(width() / 2 - exGameOverWidth / 2, height() / 3);
         exMainMenu->move(width() / 2 - 100, height() / 3 + 125);
     } else {
@@ -643,7 +659,14 @@ void MainWindow::resizeEvent(QResizeEvent *event) {
  * @param event The key press event to handle
  */
 void MainWindow::keyPressEvent(QKeyEvent *event) {
-    if (mode == Exploration) {
+    if (event->key() == Qt::Key_T && !event->isAutoRepeat() && (mode == Sandbox || mode == Exploration)) {
+        // Show or hide the paths of the bodies
+        sim->setTrailsEnabled(!sim->getTrailsEnabled());
+        simWidget->update();
+    } else if (event->key() == Qt::Key_V && !event->isAutoRepeat() && mode == Exploration) {
+        // Show or hide the zoomed out view
+        exInset->setVisible(!exInset->isVisible());
+    } else if (mode == Exploration) {
         QApplication::sendEvent(simWidget, event);
     } else {
         // Pass on key press to base class
@@ -109,6 +109,8 @@ private:
     // Elements for exploration mode
     QWidget *exContainer;
     QPushButton *exHomeButton;
+    // Zoomed out view around the rocket, in the top right corner
+    SimulationWidget *exInset;
     QLabel *exGameOver;
     int exGameOverWidth;
     QPushButton *exMainMenu;
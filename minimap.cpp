@@ -0,0 +1,138 @@
+#include <cmath>
+#include <algorithm>
+#include "minimap.h"
+
+// Width and height of the minimap in pixels
+#define MINIMAP_SIZE (MINIMAP_TILES * EXPLORED_TILE_SIZE / MINIMAP_CELLS_PER_PIXEL)
+// Width and height in pixels of each tile of the explored map on the minimap
+#define MINIMAP_TILE_PIXELS (EXPLORED_TILE_SIZE / MINIMAP_CELLS_PER_PIXEL)
+
+/**
+ * @brief Minimap::Minimap Creates an empty minimap.
+ * @param cellSize World units covered by each cell of the explored map
+ */
+Minimap::Minimap(double cellSize) {
+    this->cellSize = cellSize;
+    // Unexplored pixels are a see-through grey, fully explored ones blue, and
+    // partly explored ones in between (premultiplied)
+    int numColours = MINIMAP_CELLS_PER_PIXEL * MINIMAP_CELLS_PER_PIXEL + 1;
+    for (int i = 0; i < numColours; i++) {
+        double f = i / static_cast<double>(numColours - 1);
+        int alpha = static_cast<int>(160 + (230 - 160) * f);
+        colours[i] = qRgba(static_cast<int>((20 + (40 - 20) * f) * alpha / 255),
+                           static_cast<int>((20 + (90 - 20) * f) * alpha / 255),
+                           static_cast<int>((20 + (255 - 20) * f) * alpha / 255), alpha);
+    }
+    back = QImage(MINIMAP_SIZE, MINIMAP_SIZE, QImage::Format_ARGB32_Premultiplied);
+    front = QImage(MINIMAP_SIZE, MINIMAP_SIZE, QImage::Format_ARGB32_Premultiplied);
+    front.fill(colours[0]);
+}
+
+/**
+ * @brief Minimap::update Brings the minimap up to date with the explored map,
+ * then makes it the image drawn by draw(). Only the tiles which have changed
+ * since the last update are redrawn, unless the area covered has moved. Must
+ * only be called by one thread, while nothing else is using the map.
+ * @param map The explored map
+ * @param centre World position the minimap should be centred near. The area
+ * covered only moves when this gets close to its edge
+ */
+void Minimap::update(ExploredMap &map, QPointF centre) {
+    int centreX = static_cast<int>(floor(centre.x() / cellSize / EXPLORED_TILE_SIZE));
+    int centreY = static_cast<int>(floor(centre.y() / cellSize / EXPLORED_TILE_SIZE));
+    if (centreX <= left || centreX >= left + MINIMAP_TILES - 1 ||
+            centreY <= top || centreY >= top + MINIMAP_TILES - 1) {
+        // Centre has reached the outer ring of tiles --> Move the area covered
+        left = centreX - MINIMAP_TILES / 2;
+        top = centreY - MINIMAP_TILES / 2;
+    }
+    bool cleared = map.takeDirtyTiles(dirty);
+
+    if (cleared || backAllStale || backLeft != left || backTop != top) {
+        for (int tileY = top; tileY < top + MINIMAP_TILES; tileY++) {
+            for (int tileX = left; tileX < left + MINIMAP_TILES; tileX++) {
+                drawTile(map, tileX, tileY);
+            }
+        }
+    } else {
+        // Tiles changed by this update, and those changed by the last one,
+        // which was drawn into the other image
+        backStale.insert(backStale.end(), dirty.begin(), dirty.end());
+        for (std::vector<QPoint>::iterator iter = backStale.begin(), end = backStale.end(); iter != end; ++iter) {
+            if (iter->x() >= left && iter->x() < left + MINIMAP_TILES &&
+                    iter->y() >= top && iter->y() < top + MINIMAP_TILES) {
+                drawTile(map, iter->x(), iter->y());
+            }
+        }
+    }
+    backLeft = left;
+    backTop = top;
+
+    mut.lock();
+    front.swap(back);
+    std::swap(frontLeft, backLeft);
+    std::swap(frontTop, backTop);
+    mut.unlock();
+
+    // The image now being updated has missed this update's changes
+    backStale.swap(dirty);
+    backAllStale = cleared;
+}
+
+/**
+ * @brief Minimap::draw Draws the last finished minimap with a single blit,
+ * and a dot for the player on top.
+ * @param p The painter to draw with
+ * @param at Where to draw the top left of the minimap
+ * @param marker World position of the player
+ */
+void Minimap::draw(QPainter &p, QPoint at, QPointF marker) {
+    mut.lock();
+    p.drawImage(at, front);
+    double x = (marker.x() / cellSize - frontLeft * EXPLORED_TILE_SIZE) / MINIMAP_CELLS_PER_PIXEL;
+    double y = (marker.y() / cellSize - frontTop * EXPLORED_TILE_SIZE) / MINIMAP_CELLS_PER_PIXEL;
+    mut.unlock();
+    if (x >= 0 && x < MINIMAP_SIZE && y >= 0 && y < MINIMAP_SIZE) {
+        p.fillRect(at.x() + static_cast<int>(x) - 1, at.y() + static_cast<int>(y) - 1, 3, 3, QColor(255, 255, 255));
+    }
+}
+
+/**
+ * @brief Minimap::getSize
+ * @return Width and height of the minimap in pixels
+ */
+int Minimap::getSize() {
+    return MINIMAP_SIZE;
+}
+
+/**
+ * @brief Minimap::drawTile Redraws one tile of the explored map into the
+ * image being updated. Each pixel is coloured by how many of its cells have
+ * been explored.
+ * @param map The explored map
+ * @param tileX x-coordinate of the tile
+ * @param tileY y-coordinate of the tile
+ */
+void Minimap::drawTile(ExploredMap &map, int tileX, int tileY) {
+    uint64_t rows[EXPLORED_TILE_SIZE];
+    bool explored = map.getTile(tileX, tileY, rows);
+    int x0 = (tileX - left) * MINIMAP_TILE_PIXELS;
+    int y0 = (tileY - top) * MINIMAP_TILE_PIXELS;
+    for (int y = 0; y < MINIMAP_TILE_PIXELS; y++) {
+        QRgb *line = reinterpret_cast<QRgb*>(back.scanLine(y0 + y)) + x0;
+        if (!explored) {
+            std::fill(line, line + MINIMAP_TILE_PIXELS, colours[0]);
+            continue;
+        }
+        for (int x = 0; x < MINIMAP_TILE_PIXELS; x++) {
+            int count = 0;
+            for (int cy = 0; cy < MINIMAP_CELLS_PER_PIXEL; cy++) {
+                uint64_t row = rows[y * MINIMAP_CELLS_PER_PIXEL + cy];
+                for (int cx = 0; cx < MINIMAP_CELLS_PER_PIXEL; cx++) {
+                    count += (row >> (x * MINIMAP_CELLS_PER_PIXEL + cx)) & 1;
+                }
+            }
+            line[x] = colours[count];
+        }
+    }
+}
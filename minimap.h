@@ -0,0 +1,55 @@
+#ifndef MINIMAP_H
+#define MINIMAP_H
+
+#include <vector>
+#include <mutex>
+#include <QImage>
+#include <QPainter>
+#include "exploredmap.h"
+
+// Width and height of the minimap, in tiles of the explored map
+#define MINIMAP_TILES 5
+// Width and height of the cells of the explored map covered by each pixel
+#define MINIMAP_CELLS_PER_PIXEL 2
+
+/*
+ * Small image of the explored map around the player, for drawing in a corner
+ * of the screen. Updated by the simulation thread, which only redraws the
+ * tiles of the map that have changed. The image is double buffered, so the
+ * GUI thread can draw the finished one while the other is being updated.
+ */
+class Minimap {
+public:
+    Minimap(double cellSize);
+    void update(ExploredMap &map, QPointF centre);
+    void draw(QPainter &p, QPoint at, QPointF marker);
+    static int getSize();
+
+private:
+    void drawTile(ExploredMap &map, int tileX, int tileY);
+
+    // World units covered by each cell of the explored map
+    double cellSize;
+    // Number of explored cells (0 to 4) in a pixel -> Colour of the pixel
+    QRgb colours[MINIMAP_CELLS_PER_PIXEL * MINIMAP_CELLS_PER_PIXEL + 1];
+    // Image being updated, and the tile at its top left
+    QImage back;
+    int backLeft = 0;
+    int backTop = 0;
+    // Tiles redrawn in the other image by the last update, which must also
+    // be redrawn in this one
+    std::vector<QPoint> backStale;
+    bool backAllStale = true;
+    // Tile at the top left of the area covered, for the next update
+    int left = 0;
+    int top = 0;
+    std::vector<QPoint> dirty;
+
+    // Finished image, and the tile at its top left (guarded by mut)
+    std::mutex mut;
+    QImage front;
+    int frontLeft = 0;
+    int frontTop = 0;
+};
+
+#endif // MINIMAP_H
@@ -34,7 +34,24 @@ SOURCES += \
     sprites.cpp \
     mainwindow.cpp \
     simulationwidget.cpp \
-    rocket.cpp
+    rocket.cpp \
+    forcesolver.cpp \
+    collisiondetector.cpp \
+    integrator.cpp \
+    pool.cpp \
+    arena.cpp \
+    workerpool.cpp \
+    random.cpp \
+    exploredmap.cpp \
+    sectorstore.cpp \
+    systemindex.cpp \
+    universegenerator.cpp \
+    renderer.cpp \
+    blitter.cpp \
+    trailpool.cpp \
+    predictor.cpp \
+    minimap.cpp \
+    frameexporter.cpp
 
 HEADERS += \
     rasterwindow.h \
@@ -45,7 +62,24 @@ HEADERS += \
     sprites.h \
     mainwindow.h \
     simulationwidget.h \
-    rocket.h
+    rocket.h \
+    forcesolver.h \
+    collisiondetector.h \
+    integrator.h \
+    pool.h \
+    arena.h \
+    workerpool.h \
+    random.h \
+    exploredmap.h \
+    sectorstore.h \
+    systemindex.h \
+    universegenerator.h \
+    renderer.h \
+    blitter.h \
+    trailpool.h \
+    predictor.h \
+    minimap.h \
+    frameexporter.h
 
 FORMS += \
     rasterwindow.ui
@@ -0,0 +1,85 @@
+#include <new>
+#include "pool.h"
+
+/**
+ * @brief Pool::Pool Creates an empty pool. No memory is allocated until the
+ * first block is requested.
+ * @param blockSize Size in bytes of each block
+ * @param blocksPerChunk How many blocks to allocate from the heap at once
+ */
+Pool::Pool(size_t blockSize, size_t blocksPerChunk) {
+    // Every block must be able to hold a free list link, and stay aligned
+    size_t align = alignof(std::max_align_t);
+    if (blockSize < sizeof(FreeBlock)) blockSize = sizeof(FreeBlock);
+    this->blockSize = (blockSize + align - 1) / align * align;
+    this->blocksPerChunk = blocksPerChunk;
+}
+
+/**
+ * @brief Pool::~Pool Destructor. Frees every chunk, so all blocks must have
+ * been released (or never be used again).
+ */
+Pool::~Pool() {
+    for (std::vector<char*>::iterator iter = chunks.begin(); iter != chunks.end(); ++iter) {
+        ::operator delete(*iter);
+    }
+}
+
+/**
+ * @brief Pool::allocate Returns a block of getBlockSize() bytes, reusing a
+ * released block if there is one.
+ * @return The uninitialised block
+ */
+void* Pool::allocate() {
+    std::lock_guard<std::mutex> lock(mut);
+    if (!freeList) allocateChunk();
+    FreeBlock *block = freeList;
+    freeList = block->next;
+    numAllocated++;
+    return block;
+}
+
+/**
+ * @brief Pool::release Returns a block to the pool so it can be reused.
+ * @param block A block previously returned by allocate()
+ */
+void Pool::release(void *block) {
+    if (!block) return;
+    std::lock_guard<std::mutex> lock(mut);
+    FreeBlock *freeBlock = static_cast<FreeBlock*>(block);
+    freeBlock->next = freeList;
+    freeList = freeBlock;
+    numAllocated--;
+}
+
+/**
+ * @brief Pool::getBlockSize
+ * @return The size in bytes of each block
+ */
+size_t Pool::getBlockSize() {
+    return blockSize;
+}
+
+/**
+ * @brief Pool::getNumAllocated
+ * @return The number of blocks currently in use
+ */
+size_t Pool::getNumAllocated() {
+    std::lock_guard<std::mutex> lock(mut);
+    return numAllocated;
+}
+
+/**
+ * @brief Pool::allocateChunk Allocates a new chunk from the heap and adds
+ * all of its blocks to the free list. Must be called while mut is locked.
+ */
+void Pool::allocateChunk() {
+    char *chunk = static_cast<char*>(::operator new(blockSize * blocksPerChunk));
+    chunks.push_back(chunk);
+    // Link the blocks in order so that consecutive allocations are adjacent
+    for (size_t i = blocksPerChunk; i > 0; i--) {
+        FreeBlock *block = reinterpret_cast<FreeBlock*>(chunk + (i - 1) * blockSize);
+        block->next = freeList;
+        freeList = block;
+    }
+}
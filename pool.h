@@ -0,0 +1,59 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <cstddef>
+#include <vector>
+#include <mutex>
+
+/*
+ * Fixed-size block allocator. Blocks are carved out of large chunks and
+ * returned to a free list when released, so once enough chunks have been
+ * allocated, creating and destroying objects never touches the heap.
+ * Chunks are only freed when the pool itself is destroyed.
+ */
+class Pool {
+public:
+    Pool(size_t blockSize, size_t blocksPerChunk);
+    ~Pool();
+    void* allocate();
+    void release(void *block);
+    template <typename T>
+    void releaseAll(const std::vector<T*> &blocks);
+    size_t getBlockSize();
+    size_t getNumAllocated();
+
+private:
+    void allocateChunk();
+
+    // Released blocks are linked together through their own memory
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    size_t blockSize;
+    size_t blocksPerChunk;
+    FreeBlock *freeList = nullptr;
+    std::vector<char*> chunks;
+    size_t numAllocated = 0; // Blocks currently handed out
+    std::mutex mut; // Bodies are created on both the GUI and simulation threads
+};
+
+/**
+ * @brief Pool::releaseAll Returns many blocks to the pool at once, locking it
+ * only once, so a thread freeing lots of objects doesn't fight the others for
+ * the lock each time. The objects must already have been destroyed.
+ * @param blocks Blocks previously returned by allocate(). Null pointers are skipped
+ */
+template <typename T>
+void Pool::releaseAll(const std::vector<T*> &blocks) {
+    std::lock_guard<std::mutex> lock(mut);
+    for (typename std::vector<T*>::const_iterator iter = blocks.begin(); iter != blocks.end(); ++iter) {
+        if (!*iter) continue;
+        FreeBlock *freeBlock = static_cast<FreeBlock*>(static_cast<void*>(*iter));
+        freeBlock->next = freeList;
+        freeList = freeBlock;
+        numAllocated--;
+    }
+}
+
+#endif // POOL_H
@@ -0,0 +1,282 @@
+#include <cmath>
+#include <algorithm>
+#include "predictor.h"
+#include "forcesolver.h"
+
+// Number of ticks predicted ahead
+#define PREDICTION_TICKS 600
+// Only bodies this close to the subject pull on it in the prediction
+#define PREDICTION_RANGE 3000
+// Most bodies copied for the subject to be pulled by
+#define MAX_PREDICTION_SOURCES 64
+// How far (in each of x and y) the subject can stray from its predicted
+// path before the path is predicted again from the start
+#define POSITION_TOLERANCE 1.0
+#define VELOCITY_TOLERANCE 0.05
+// Paths are predicted again from the start at least this often (ticks),
+// since bodies outside the prediction slowly pull it off course
+#define FULL_PREDICTION_INTERVAL 120
+// Ticks between the points of the published path
+#define PATH_POINT_INTERVAL 4
+
+/**
+ * @brief Predictor::Predictor Creates the predictor and starts its thread,
+ * which waits until a prediction is requested.
+ */
+Predictor::Predictor() {
+    thread = std::thread(&Predictor::work, this);
+}
+
+/**
+ * @brief Predictor::~Predictor Destructor. Waits for the prediction being
+ * made to finish, then stops the predictor thread.
+ */
+Predictor::~Predictor() {
+    mut.lock();
+    stopping = true;
+    mut.unlock();
+    wake.notify_one();
+    thread.join();
+}
+
+/**
+ * @brief Predictor::requestPrediction Asks for the subject's path to be
+ * predicted from its current state. If the predictor is still busy, this
+ * replaces any request made before which it hasn't started yet.
+ * @param subject The body to predict the path of
+ * @param bodies Snapshot of the simulation's bodies, to pick the bodies
+ * pulling on the subject from. Anything of type PlayerRocket is skipped
+ * @param thrusting True if the subject is being pushed by something other
+ * than gravity, so it will have left its predicted path
+ * @param tick Tick of the simulation the snapshot was taken at
+ * @param origin World position of the origin the snapshot's positions are
+ * relative to
+ * @param G The gravitational constant
+ */
+void Predictor::requestPrediction(Body &subject, std::vector<Body> &bodies, bool thrusting,
+                                  long long tick, QPointF origin, double G) {
+    double subjectX = subject.getX(), subjectY = subject.getY();
+    // Only copy the nearby bodies heavy enough to change the subject's path
+    std::vector<Body*> sources;
+    for (std::vector<Body>::iterator iter = bodies.begin(), end = bodies.end(); iter != end; ++iter) {
+        if (!iter->isActive() || iter->getType() == Body::PlayerRocket) continue;
+        if (fabs(iter->getX() - subjectX) + fabs(iter->getY() - subjectY) > PREDICTION_RANGE) continue;
+        if (iter->getMass() / subject.getMass() <= FORCE_MIN_MASS_RATIO) continue;
+        sources.push_back(&*iter);
+    }
+    if (sources.size() > MAX_PREDICTION_SOURCES) {
+        // Keep the heaviest, in the same order as the snapshot so that the
+        // predictor can tell when the set has changed
+        std::vector<Body*> heaviest(sources);
+        std::nth_element(heaviest.begin(), heaviest.begin() + (MAX_PREDICTION_SOURCES - 1), heaviest.end(),
+                         [](Body *a, Body *b) { return a->getMass() > b->getMass(); });
+        double minMass = heaviest[MAX_PREDICTION_SOURCES - 1]->getMass();
+        std::vector<Body*> kept;
+        for (std::vector<Body*>::iterator iter = sources.begin(), end = sources.end(); iter != end; ++iter) {
+            if ((*iter)->getMass() >= minMass && kept.size() < MAX_PREDICTION_SOURCES) kept.push_back(*iter);
+        }
+        sources.swap(kept);
+    }
+
+    mut.lock();
+    requestedBodies.clear();
+    PredictedBody b;
+    b.x = subjectX + origin.x();
+    b.y = subjectY + origin.y();
+    b.vx = subject.getVelX();
+    b.vy = subject.getVelY();
+    b.mass = subject.getMass();
+    b.diameter = subject.getDiameter();
+    requestedBodies.push_back(b);
+    for (std::vector<Body*>::iterator iter = sources.begin(), end = sources.end(); iter != end; ++iter) {
+        b.x = (*iter)->getX() + origin.x();
+        b.y = (*iter)->getY() + origin.y();
+        b.vx = (*iter)->getVelX();
+        b.vy = (*iter)->getVelY();
+        b.mass = (*iter)->getMass();
+        b.diameter = (*iter)->getDiameter();
+        requestedBodies.push_back(b);
+    }
+    requestedThrusting = thrusting;
+    requestedTick = tick;
+    requestedG = G;
+    predictionRequested = true;
+    cleared = false;
+    mut.unlock();
+    wake.notify_one();
+}
+
+/**
+ * @brief Predictor::clear Throws away the current path, for when there is
+ * nothing to predict any more. The next request is predicted from the start.
+ */
+void Predictor::clear() {
+    mut.lock();
+    predictionRequested = false;
+    cleared = true;
+    publishedPath.clear();
+    mut.unlock();
+}
+
+/**
+ * @brief Predictor::getPath Gets the latest predicted path.
+ * @param path Filled with points along the path in world coordinates,
+ * starting from the subject. Empty if there is no prediction yet
+ */
+void Predictor::getPath(std::vector<QPointF> &path) {
+    mut.lock();
+    path = publishedPath;
+    mut.unlock();
+}
+
+/**
+ * @brief Predictor::work The predictor thread. Makes each requested
+ * prediction, then publishes it to be read by getPath().
+ */
+void Predictor::work() {
+    std::unique_lock<std::mutex> lock(mut);
+    while (true) {
+        wake.wait(lock, [this] { return predictionRequested || stopping; });
+        if (stopping) return;
+        bodies.swap(requestedBodies);
+        thrusting = requestedThrusting;
+        tick = requestedTick;
+        G = requestedG;
+        if (cleared) {
+            // Nothing to extend
+            path.clear();
+            cleared = false;
+        }
+        predictionRequested = false;
+        lock.unlock();
+
+        predict();
+
+        lock.lock();
+        if (!cleared) publish();
+    }
+}
+
+/**
+ * @brief Predictor::predict Brings the path up to date with the latest
+ * request. If the subject is where the path said it would be and the same
+ * bodies are pulling on it, the ticks which have passed are dropped from the
+ * front of the path and the same number are added to the end. Otherwise the
+ * whole path is predicted again.
+ */
+void Predictor::predict() {
+    long long passed = tick - pathTick;
+    bool extendable = !thrusting && !path.empty() && passed >= 0 &&
+            passed < static_cast<long long>(path.size()) &&
+            tick - fullPredictionTick < FULL_PREDICTION_INTERVAL &&
+            tail.size() == bodies.size();
+    if (extendable) {
+        // Have the bodies pulling on the subject changed, e.g. by colliding?
+        for (size_t i = 1; i < bodies.size(); i++) {
+            if (bodies[i].mass != tail[i].mass || bodies[i].diameter != tail[i].diameter) {
+                extendable = false;
+                break;
+            }
+        }
+    }
+    if (extendable) {
+        // Is the subject still on its path?
+        PredictedBody &expected = path[static_cast<size_t>(passed)];
+        extendable = fabs(expected.x - bodies[0].x) < POSITION_TOLERANCE &&
+                fabs(expected.y - bodies[0].y) < POSITION_TOLERANCE &&
+                fabs(expected.vx - bodies[0].vx) < VELOCITY_TOLERANCE &&
+                fabs(expected.vy - bodies[0].vy) < VELOCITY_TOLERANCE;
+    }
+
+    if (extendable) {
+        path.erase(path.begin(), path.begin() + static_cast<long>(passed));
+        pathTick = tick;
+        extend(static_cast<int>(passed));
+    } else {
+        path.clear();
+        path.push_back(bodies[0]);
+        tail = bodies;
+        pathTick = tick;
+        fullPredictionTick = tick;
+        crashed = hasCrashed(tail);
+        extend(PREDICTION_TICKS);
+    }
+}
+
+/**
+ * @brief Predictor::extend Adds the given number of ticks to the end of the
+ * path, stopping early if the subject hits another body.
+ * @param steps Number of ticks to add
+ */
+void Predictor::extend(int steps) {
+    for (int i = 0; i < steps && !crashed; i++) {
+        step(tail);
+        path.push_back(tail[0]);
+        crashed = hasCrashed(tail);
+    }
+}
+
+/**
+ * @brief Predictor::step Moves the bodies on by one tick, in the same way as
+ * the simulation's brute force solver and Euler integrator: every velocity
+ * is updated from the current positions, then every body is moved. The
+ * other solvers give the same forces (with the same cut-offs), and only pay
+ * off with many bodies, whereas the prediction has at most
+ * MAX_PREDICTION_SOURCES.
+ * @param state The bodies to move
+ */
+void Predictor::step(std::vector<PredictedBody> &state) {
+    size_t n = state.size();
+    for (size_t i = 0; i < n; i++) {
+        PredictedBody &body = state[i];
+        for (size_t j = 0; j < n; j++) {
+            if (i == j) continue;
+            PredictedBody &other = state[j];
+            double dx = other.x - body.x, dy = other.y - body.y;
+            // Same cut-offs as the simulation, so the prediction matches it
+            if (fabs(dx) + fabs(dy) >= FORCE_CUTOFF_DISTANCE || other.mass / body.mass <= FORCE_MIN_MASS_RATIO) continue;
+            double sqDist = dx * dx + dy * dy;
+            if (sqDist >= FORCE_CUTOFF_SQ_DISTANCE) continue;
+            double dist = sqrt(sqDist);
+            if (dist < 1) dist = 1;
+            double factor = G * other.mass / (dist * dist * dist);
+            body.vx += dx * factor;
+            body.vy += dy * factor;
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        state[i].x += state[i].vx;
+        state[i].y += state[i].vy;
+    }
+}
+
+/**
+ * @brief Predictor::hasCrashed Checks whether the subject is touching any
+ * of the other bodies.
+ * @param state The bodies, with the subject first
+ * @return True if the subject is touching another body
+ */
+bool Predictor::hasCrashed(std::vector<PredictedBody> &state) {
+    PredictedBody &subject = state[0];
+    for (size_t i = 1; i < state.size(); i++) {
+        double dx = state[i].x - subject.x, dy = state[i].y - subject.y;
+        double reach = (state[i].diameter + subject.diameter) / 2;
+        if (dx * dx + dy * dy < reach * reach) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Predictor::publish Copies every PATH_POINT_INTERVAL'th point of the
+ * path, and the last, to be read by getPath(). Must be called while mut is
+ * locked.
+ */
+void Predictor::publish() {
+    publishedPath.clear();
+    for (size_t i = 0; i < path.size(); i += PATH_POINT_INTERVAL) {
+        publishedPath.push_back(QPointF(path[i].x, path[i].y));
+    }
+    if (!path.empty() && (path.size() - 1) % PATH_POINT_INTERVAL != 0) {
+        publishedPath.push_back(QPointF(path.back().x, path.back().y));
+    }
+}
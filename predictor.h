@@ -0,0 +1,81 @@
+#ifndef PREDICTOR_H
+#define PREDICTOR_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <QPointF>
+#include "body.h"
+
+/*
+ * Predicts the path of a single body (the rocket, or a body about to be
+ * spawned) on its own thread. The bodies pulling on it are copied from a
+ * snapshot the caller already has, so the simulation is never held up.
+ * Only the heavier bodies near it are copied, and they move under each
+ * other's gravity in the same way as in the simulation. While the body
+ * stays on its predicted path, the path is only extended by the ticks that
+ * have passed rather than predicted again from the start.
+ */
+class Predictor {
+public:
+    Predictor();
+    ~Predictor();
+    void requestPrediction(Body &subject, std::vector<Body> &bodies, bool thrusting,
+                           long long tick, QPointF origin, double G);
+    void clear();
+    void getPath(std::vector<QPointF> &path);
+
+private:
+    // Copy of a body, with only what is needed to move it
+    struct PredictedBody {
+        double x;
+        double y;
+        double vx;
+        double vy;
+        double mass;
+        double diameter;
+    };
+
+    void work();
+    void predict();
+    void step(std::vector<PredictedBody> &state);
+    bool hasCrashed(std::vector<PredictedBody> &state);
+    void extend(int steps);
+    void publish();
+
+    std::thread thread;
+    std::mutex mut;
+    // Signalled when a prediction is requested, or the predictor is stopping
+    std::condition_variable wake;
+    bool predictionRequested = false;
+    bool stopping = false;
+
+    // The latest request, guarded by mut. The subject is first
+    std::vector<PredictedBody> requestedBodies;
+    bool requestedThrusting = false;
+    long long requestedTick = 0;
+    double requestedG = 0;
+    // Set by clear() to throw away the current path, guarded by mut
+    bool cleared = false;
+
+    // Only used by the predictor thread
+    std::vector<PredictedBody> bodies;
+    bool thrusting = false;
+    long long tick = 0;
+    double G = 0;
+    // State of the subject after each tick, starting at pathTick
+    std::vector<PredictedBody> path;
+    long long pathTick = 0;
+    // When the path was last predicted from the start
+    long long fullPredictionTick = 0;
+    // State of every body at the end of the path, to extend it from
+    std::vector<PredictedBody> tail;
+    // Has the subject hit another body at the end of the path?
+    bool crashed = false;
+
+    // Points along the path for drawing, in world coordinates, guarded by mut
+    std::vector<QPointF> publishedPath;
+};
+
+#endif // PREDICTOR_H
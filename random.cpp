@@ -0,0 +1,63 @@
+#include "random.h"
+
+/**
+ * @brief Random::Random Creates a generator for the given key.
+ * @param key Decides the sequence of numbers generated
+ */
+Random::Random(uint64_t key) {
+    this->key = hash(key);
+}
+
+/**
+ * @brief Random::next Returns the next number in the sequence.
+ * @return A random number using all 64 bits
+ */
+uint64_t Random::next() {
+    // Weyl sequence of the counter, offset by the key, then mixed
+    return hash(key + ++counter * 0x9E3779B97F4A7C15ULL);
+}
+
+/**
+ * @brief Random::nextInt Returns the next number in the sequence, between
+ * 0 and n - 1. A drop-in replacement for rand() % n.
+ * @param n How many possible values there are. Must be positive
+ * @return A random number from 0 to n - 1
+ */
+int Random::nextInt(int n) {
+    // Take the top 32 bits and scale them down, which avoids a division
+    return static_cast<int>(((next() >> 32) * static_cast<uint64_t>(n)) >> 32);
+}
+
+/**
+ * @brief Random::nextDouble Returns the next number in the sequence, as a
+ * double between 0 (inclusive) and 1 (exclusive).
+ * @return A random number in [0, 1)
+ */
+double Random::nextDouble() {
+    // 53 random bits fill the mantissa exactly
+    return (next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * @brief Random::hash Mixes the bits of x (the SplitMix64 finaliser). Every
+ * input gives a different output, and nearby inputs give unrelated outputs.
+ * @param x The value to hash
+ * @return The hashed value
+ */
+uint64_t Random::hash(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief Random::sectorKey Returns the key for a sector of a universe.
+ * @param seed The seed of the universe
+ * @param sectorX x-coordinate of the sector
+ * @param sectorY y-coordinate of the sector
+ * @return A key which is unrelated to the keys of neighbouring sectors
+ */
+uint64_t Random::sectorKey(uint64_t seed, int sectorX, int sectorY) {
+    uint64_t h = hash(seed) ^ static_cast<uint32_t>(sectorX);
+    return hash(h) ^ static_cast<uint32_t>(sectorY);
+}
@@ -0,0 +1,28 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+
+/*
+ * Counter-based random number generator. The n-th number is a hash of the
+ * key and n, so a generator made with the same key always gives the same
+ * sequence, on any thread and in any order relative to other generators.
+ * Used to make each sector of the universe from a key rather than from the
+ * global rand() state.
+ */
+class Random {
+public:
+    Random(uint64_t key);
+    uint64_t next();
+    int nextInt(int n);
+    double nextDouble();
+
+    static uint64_t hash(uint64_t x);
+    static uint64_t sectorKey(uint64_t seed, int sectorX, int sectorY);
+
+private:
+    uint64_t key;
+    uint64_t counter = 0; // How many numbers have been generated
+};
+
+#endif // RANDOM_H
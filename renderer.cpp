@@ -0,0 +1,545 @@
+#include <algorithm>
+#include <cmath>
+#include <QPainter>
+#include "renderer.h"
+#include "blitter.h"
+
+// Width and height in pixels of the tiles each frame is split into
+#define TILE_SIZE 128
+// Bodies narrower than this many pixels on screen are drawn as points
+// rather than sprites
+#define POINT_SPRITE_SIZE 2
+// Opacity of the trails behind bodies (0 - 255)
+#define TRAIL_ALPHA 140
+// Trail segments shorter than this many pixels are joined on to the next one
+#define TRAIL_MIN_SEGMENT 2.0
+// Default number of bodies on screen above which a heatmap is drawn instead
+#define HEATMAP_THRESHOLD 30000
+// Heatmap densities below this fraction of the highest fade into the background
+#define HEATMAP_FADE 0.3
+
+/**
+ * @brief Renderer::Renderer Creates the renderer and starts its thread, which
+ * waits until a frame is requested.
+ * @param sprites The sprites to draw bodies with
+ */
+Renderer::Renderer(Sprites sprites) {
+    this->sprites = sprites;
+    // Pixmaps can't be used off the GUI thread --> Convert them all to images now,
+    // in the format the blitter draws
+    for (int i = 0; i < Sprites::NumSprites; i++) {
+        spriteImages[i] = sprites.getSprite(static_cast<Sprites::SpriteId>(i)).toImage()
+                .convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+    backgroundImage = sprites.backgroundImage.toImage();
+    for (int i = 0; i < sprites.getAnimationLength(Sprites::RocketExplosionAnimation); i++) {
+        explosionFrames.push_back(sprites.getAnimationFrame(Sprites::RocketExplosionAnimation, i).toImage());
+    }
+    heatmapThreshold = requestedHeatmapThreshold = HEATMAP_THRESHOLD;
+    // Build the heatmap's colour ramp: purple through red and yellow to white
+    const double stops[][4] = {{0, 40, 0, 80}, {0.35, 160, 30, 120}, {0.6, 230, 90, 40},
+                               {0.85, 255, 200, 60}, {1, 255, 255, 230}};
+    for (int i = 0; i < 256; i++) {
+        double t = i / 255.0;
+        int stop = 0;
+        while (stop < 3 && t > stops[stop + 1][0]) stop++;
+        double f = (t - stops[stop][0]) / (stops[stop + 1][0] - stops[stop][0]);
+        double alpha = std::min(t / HEATMAP_FADE, 1.0);
+        int colour[3];
+        for (int c = 0; c < 3; c++) {
+            colour[c] = static_cast<int>((stops[stop][c + 1] + (stops[stop + 1][c + 1] - stops[stop][c + 1]) * f) * alpha + 0.5);
+        }
+        heatRamp[i] = qRgba(colour[0], colour[1], colour[2], static_cast<int>(alpha * 255 + 0.5));
+    }
+    // The render thread draws tiles too, so leave one core for it
+    int numWorkers = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+    workers = new WorkerPool(numWorkers > 0 ? numWorkers : 0);
+    thread = std::thread(&Renderer::work, this);
+}
+
+/**
+ * @brief Renderer::~Renderer Destructor. Waits for the frame being drawn to
+ * finish, then stops the render thread.
+ */
+Renderer::~Renderer() {
+    mut.lock();
+    stopping = true;
+    mut.unlock();
+    wake.notify_one();
+    thread.join();
+    delete workers;
+}
+
+/**
+ * @brief Renderer::requestFrame Asks for a frame to be drawn. If the render
+ * thread is still busy, this replaces any frame requested before which it
+ * hasn't started yet.
+ * @param snapshot The bodies and trails to draw. Shared rather than copied,
+ * so it can be drawn by several renderers at once
+ * @param rocket Snapshot of the player controlled rocket
+ * @param view What to draw and where the camera is
+ */
+void Renderer::requestFrame(const std::shared_ptr<Simulation::Snapshot> &snapshot, const Rocket &rocket, const View &view) {
+    mut.lock();
+    requestedSnapshot = snapshot;
+    requestedRocket = rocket;
+    requestedView = view;
+    frameRequested = true;
+    mut.unlock();
+    wake.notify_one();
+}
+
+/**
+ * @brief Renderer::takeFrame Gets the last finished frame, if there is one
+ * that hasn't been taken yet.
+ * @param frame Swapped with the finished frame. The old image is reused for
+ * a later frame
+ * @return True if there was a new frame
+ */
+bool Renderer::takeFrame(QImage &frame) {
+    mut.lock();
+    bool taken = frameReady;
+    if (frameReady) {
+        frame.swap(readyFrame);
+        frameReady = false;
+    }
+    mut.unlock();
+    return taken;
+}
+
+/**
+ * @brief Renderer::waitForFrame Waits for the frame requested last to be
+ * finished, then takes it. For drawing offscreen, where every frame is needed.
+ * @param frame Swapped with the finished frame. The old image is reused for
+ * a later frame
+ */
+void Renderer::waitForFrame(QImage &frame) {
+    std::unique_lock<std::mutex> lock(mut);
+    frameDone.wait(lock, [this] { return frameReady && !frameRequested && !rendering; });
+    frame.swap(readyFrame);
+    frameReady = false;
+}
+
+/**
+ * @brief Renderer::isBusy Checks whether the frame last requested is still
+ * being drawn, or is finished but has not been taken to be shown yet, so the
+ * caller knows to come back for it. Once it has been taken the renderer is
+ * idle until another frame is requested.
+ * @return True if the latest frame requested has not been taken yet
+ */
+bool Renderer::isBusy() {
+    mut.lock();
+    bool busy = frameRequested || rendering || frameReady;
+    mut.unlock();
+    return busy;
+}
+
+/**
+ * @brief Renderer::setHeatmapSettings Sets when the bodies are drawn as a
+ * heatmap of their density, rather than one by one. Takes effect from the
+ * next frame requested.
+ * @param threshold Number of bodies on screen above which the heatmap is drawn
+ * @param byMass True to show the density of mass, rather than of bodies
+ */
+void Renderer::setHeatmapSettings(int threshold, bool byMass) {
+    mut.lock();
+    requestedHeatmapThreshold = threshold;
+    requestedHeatmapByMass = byMass;
+    mut.unlock();
+}
+
+/**
+ * @brief Renderer::work The render thread. Draws each requested frame, then
+ * hands it over to be taken by takeFrame().
+ */
+void Renderer::work() {
+    std::unique_lock<std::mutex> lock(mut);
+    while (true) {
+        wake.wait(lock, [this] { return frameRequested || stopping; });
+        if (stopping) return;
+        snapshot.swap(requestedSnapshot);
+        rocket = requestedRocket;
+        view = requestedView;
+        heatmapThreshold = requestedHeatmapThreshold;
+        heatmapByMass = requestedHeatmapByMass;
+        frameRequested = false;
+        rendering = true;
+        lock.unlock();
+
+        render();
+        snapshot.reset();
+
+        lock.lock();
+        rendering = false;
+        backFrame.swap(readyFrame);
+        frameReady = true;
+        frameDone.notify_all();
+    }
+}
+
+/**
+ * @brief Renderer::render Draws the current snapshot into backFrame. The
+ * bodies and trails are sorted into the tiles they cover, then the tiles are drawn in
+ * parallel, then the rocket is drawn over the top. With more than
+ * heatmapThreshold bodies on screen, their density is drawn instead.
+ */
+void Renderer::render() {
+    if (view.width <= 0 || view.height <= 0 || !snapshot) return;
+    std::vector<Body> &bodies = snapshot->bodies;
+    if (backFrame.width() != view.width || backFrame.height() != view.height) {
+        backFrame = QImage(view.width, view.height, QImage::Format_ARGB32_Premultiplied);
+    }
+    if (view.backgroundScale != backgroundTileScale) {
+        // Zoom has changed --> Rescale the background once, rather than every frame
+        backgroundTile = backgroundImage.scaled(static_cast<int>(backgroundImage.width() * view.backgroundScale),
+                                                static_cast<int>(backgroundImage.height() * view.backgroundScale),
+                                                Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        backgroundTileScale = view.backgroundScale;
+    }
+
+    tilesX = (view.width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (view.height + TILE_SIZE - 1) / TILE_SIZE;
+    size_t numTiles = static_cast<size_t>(tilesX * tilesY);
+    if (tileSprites.size() < numTiles) {
+        tileSprites.resize(numTiles);
+        tilePoints.resize(numTiles);
+        tileTrailLines.resize(numTiles);
+        tileTrailColours.resize(numTiles);
+        tileHeat.resize(numTiles);
+        tileHeatMax.resize(numTiles);
+    }
+    // Empty last frame's tiles, keeping their memory
+    for (size_t i = 0; i < numTiles; i++) {
+        tileSprites[i].clear();
+        tilePoints[i].clear();
+        tileTrailLines[i].clear();
+        tileTrailColours[i].clear();
+        tileHeat[i].clear();
+    }
+    binTrails();
+    bool mipUsed[Sprites::NumSprites][Sprites::NumMipLevels] = {};
+
+    double viewRight = view.left + view.width / view.scale;
+    double viewBottom = view.top + view.height / view.scale;
+    // Are there too many bodies on screen to draw one by one?
+    int onScreen = 0;
+    for (std::vector<Body>::iterator iter = bodies.begin(), end = bodies.end(); iter != end; ++iter) {
+        double bodyX = iter->getPrevX() + (iter->getX() - iter->getPrevX()) * view.interpolation;
+        double bodyY = iter->getPrevY() + (iter->getY() - iter->getPrevY()) * view.interpolation;
+        if (bodyX >= view.left && bodyX < viewRight && bodyY >= view.top && bodyY < viewBottom) onScreen++;
+    }
+    drawHeatmap = onScreen > heatmapThreshold;
+    for (std::vector<Body>::iterator iter = bodies.begin(), end = bodies.end(); iter != end; ++iter) {
+        if (iter->getType() == Body::PlayerRocket) {
+            // Drawn on top of everything else by renderRocket(), from the
+            // rocket copy. The snapshot only holds the rocket's Body part,
+            // so it can't be looked up as a Rocket
+            continue;
+        }
+        double radius = iter->getDiameter() / 2.0;
+        // Where the body is at the time the frame will be shown
+        double bodyX = iter->getPrevX() + (iter->getX() - iter->getPrevX()) * view.interpolation;
+        double bodyY = iter->getPrevY() + (iter->getY() - iter->getPrevY()) * view.interpolation;
+        if (bodyX + radius < view.left || bodyX - radius > viewRight ||
+                bodyY + radius < view.top || bodyY - radius > viewBottom) {
+            // Body is off screen
+            continue;
+        }
+        if (drawHeatmap) {
+            // Add the body to the pixel its centre is in
+            HeatPoint point;
+            point.x = static_cast<int>(view.scale * (bodyX - view.left));
+            point.y = static_cast<int>(view.scale * (bodyY - view.top));
+            if (point.x < 0 || point.x >= view.width || point.y < 0 || point.y >= view.height) continue;
+            point.weight = heatmapByMass ? static_cast<float>(iter->getMass()) : 1.0f;
+            tileHeat[static_cast<size_t>((point.y / TILE_SIZE) * tilesX + point.x / TILE_SIZE)].push_back(point);
+            continue;
+        }
+        Sprites::SpriteId id = sprites.getSpriteId(&*iter);
+        double diameter = radius * 2 * view.scale;
+        double x = view.scale * (bodyX - view.left);
+        double y = view.scale * (bodyY - view.top);
+        if (diameter < POINT_SPRITE_SIZE) {
+            // Too small for the sprite to be seen --> Draw a single pixel, or a
+            // 2x2 splat if it covers more than a pixel, in the sprite's colour
+            PointDraw point;
+            point.x = static_cast<int>(x);
+            point.y = static_cast<int>(y);
+            point.size = diameter < 1 ? 1 : 2;
+            point.colour = sprites.getAverageColor(id);
+            // A splat can cross into the next tile
+            int lastTileX = std::min((point.x + point.size - 1) / TILE_SIZE, tilesX - 1);
+            int lastTileY = std::min((point.y + point.size - 1) / TILE_SIZE, tilesY - 1);
+            for (int ty = std::max(point.y / TILE_SIZE, 0); ty <= lastTileY; ty++) {
+                for (int tx = std::max(point.x / TILE_SIZE, 0); tx <= lastTileX; tx++) {
+                    tilePoints[static_cast<size_t>(ty * tilesX + tx)].push_back(point);
+                }
+            }
+            continue;
+        }
+        SpriteDraw draw;
+        draw.target = QRectF(x - diameter / 2, y - diameter / 2, diameter, diameter);
+        draw.sprite = id;
+        draw.level = Sprites::getMipLevel(spriteImages[id].size(), diameter);
+        mipUsed[draw.sprite][draw.level] = true;
+        // Add the body to every tile it covers
+        int firstTileX = std::max(static_cast<int>(floor(draw.target.left() / TILE_SIZE)), 0);
+        int firstTileY = std::max(static_cast<int>(floor(draw.target.top() / TILE_SIZE)), 0);
+        int lastTileX = std::min(static_cast<int>(floor(draw.target.right() / TILE_SIZE)), tilesX - 1);
+        int lastTileY = std::min(static_cast<int>(floor(draw.target.bottom() / TILE_SIZE)), tilesY - 1);
+        for (int ty = firstTileY; ty <= lastTileY; ty++) {
+            for (int tx = firstTileX; tx <= lastTileX; tx++) {
+                tileSprites[static_cast<size_t>(ty * tilesX + tx)].push_back(draw);
+            }
+        }
+    }
+
+    // Fetch every mip the tiles need now, since the cache can only be used
+    // from this thread
+    for (int i = 0; i < Sprites::NumSprites; i++) {
+        for (int j = 0; j < Sprites::NumMipLevels; j++) {
+            mips[i][j] = mipUsed[i][j] ? sprites.getMip(spriteImages[i], j) : QImage();
+            if (!mips[i][j].isNull() && mips[i][j].format() != QImage::Format_ARGB32_Premultiplied) {
+                mips[i][j] = mips[i][j].convertToFormat(QImage::Format_ARGB32_Premultiplied);
+            }
+        }
+    }
+
+    frameBits = backFrame.bits();
+    frameStride = backFrame.bytesPerLine();
+    if (drawHeatmap) {
+        // Add up the weights of each pixel first, since the colours depend
+        // on the highest in the frame
+        heat.resize(static_cast<size_t>(view.width * view.height));
+        workers->run(tilesX * tilesY, [this](int tile) { accumulateHeatTile(tile); });
+        heatMax = 0;
+        for (size_t i = 0; i < numTiles; i++) {
+            heatMax = std::max(heatMax, tileHeatMax[i]);
+        }
+    }
+    workers->run(tilesX * tilesY, [this](int tile) { renderTile(tile); });
+
+    if (view.drawRocket) {
+        renderRocket();
+    }
+}
+
+/**
+ * @brief Renderer::binTrails Sorts the segments of every trail into the
+ * tiles they cover, in screen coordinates. Each trail is joined up to where
+ * its body is drawn, since the body has moved on since its last position was
+ * recorded. Positions closer together on screen than TRAIL_MIN_SEGMENT
+ * pixels are skipped, so a zoomed out view doesn't draw more segments than
+ * it can show.
+ */
+void Renderer::binTrails() {
+    std::vector<Body> &bodies = snapshot->bodies;
+    TrailSnapshot &trails = snapshot->trails;
+    size_t start = 0;
+    for (size_t i = 0; i < trails.lengths.size(); i++) {
+        int length = trails.lengths[i];
+        Body &body = bodies[static_cast<size_t>(trails.bodies[i])];
+        // The snapshot only holds the rocket's Body part --> Don't look it up as a Rocket
+        Sprites::SpriteId id = body.getType() == Body::PlayerRocket ? Sprites::RocketIdleSprite
+                                                                    : sprites.getSpriteId(&body);
+        QRgb colour = sprites.getAverageColor(id);
+        colour = qRgba(qRed(colour), qGreen(colour), qBlue(colour), TRAIL_ALPHA);
+        QPointF bodyPos(body.getPrevX() + (body.getX() - body.getPrevX()) * view.interpolation,
+                        body.getPrevY() + (body.getY() - body.getPrevY()) * view.interpolation);
+        const float *points = &trails.points[start * 2];
+        QPointF from = (QPointF(points[0], points[1]) - QPointF(view.left, view.top)) * view.scale;
+        for (int j = 1; j <= length; j++) {
+            QPointF to = ((j < length ? QPointF(points[j * 2], points[j * 2 + 1]) : bodyPos)
+                          - QPointF(view.left, view.top)) * view.scale;
+            if (j < length && fabs(to.x() - from.x()) < TRAIL_MIN_SEGMENT && fabs(to.y() - from.y()) < TRAIL_MIN_SEGMENT) {
+                // Too short to see --> Join it on to the next segment
+                continue;
+            }
+            if (std::max(from.x(), to.x()) < 0 || std::min(from.x(), to.x()) > view.width ||
+                    std::max(from.y(), to.y()) < 0 || std::min(from.y(), to.y()) > view.height) {
+                // Segment is off screen
+                from = to;
+                continue;
+            }
+            // Add the segment to every tile its bounding box covers
+            int firstTileX = std::max(static_cast<int>(floor(std::min(from.x(), to.x()) / TILE_SIZE)), 0);
+            int firstTileY = std::max(static_cast<int>(floor(std::min(from.y(), to.y()) / TILE_SIZE)), 0);
+            int lastTileX = std::min(static_cast<int>(floor(std::max(from.x(), to.x()) / TILE_SIZE)), tilesX - 1);
+            int lastTileY = std::min(static_cast<int>(floor(std::max(from.y(), to.y()) / TILE_SIZE)), tilesY - 1);
+            for (int ty = firstTileY; ty <= lastTileY; ty++) {
+                for (int tx = firstTileX; tx <= lastTileX; tx++) {
+                    size_t tile = static_cast<size_t>(ty * tilesX + tx);
+                    tileTrailLines[tile].push_back(from);
+                    tileTrailLines[tile].push_back(to);
+                    tileTrailColours[tile].push_back(colour);
+                }
+            }
+            from = to;
+        }
+        start += static_cast<size_t>(length);
+    }
+}
+
+/**
+ * @brief Renderer::renderTile Draws one tile of the frame: the background,
+ * then the trails, then the bodies drawn as points, then the bodies drawn with sprites.
+ * Each tile paints its own part of backFrame's memory, so tiles can be drawn
+ * at the same time. Sprites are drawn with the Blitter rather than QPainter,
+ * since there can be thousands of them.
+ * @param tile Index of the tile, counting from top left to bottom right
+ */
+void Renderer::renderTile(int tile) {
+    int x0 = (tile % tilesX) * TILE_SIZE;
+    int y0 = (tile / tilesX) * TILE_SIZE;
+    int width = std::min(TILE_SIZE, view.width - x0);
+    int height = std::min(TILE_SIZE, view.height - y0);
+    // An image sharing the tile's part of the frame's memory
+    QImage tileImage(frameBits + y0 * frameStride + x0 * static_cast<int>(sizeof(QRgb)),
+                     width, height, frameStride, QImage::Format_ARGB32_Premultiplied);
+    QPainter p(&tileImage);
+    p.setRenderHint(QPainter::Antialiasing);
+    // Draw using the frame's coordinates
+    p.translate(-x0, -y0);
+
+    // Draw black background
+    p.fillRect(x0, y0, width, height, QColor(0, 0, 0));
+    // Draw every copy of the background which covers the tile
+    int backgroundWidth = backgroundTile.width();
+    int backgroundHeight = backgroundTile.height();
+    if (backgroundWidth > 0 && backgroundHeight > 0) {
+        int firstX = x0 - (((x0 - static_cast<int>(view.backgroundX)) % backgroundWidth) + backgroundWidth) % backgroundWidth;
+        int firstY = y0 - (((y0 - static_cast<int>(view.backgroundY)) % backgroundHeight) + backgroundHeight) % backgroundHeight;
+        for (int y = firstY; y < y0 + height; y += backgroundHeight) {
+            for (int x = firstX; x < x0 + width; x += backgroundWidth) {
+                p.drawImage(x, y, backgroundTile);
+            }
+        }
+    }
+    // Draw the trails, with one call for each run of segments of the same colour
+    std::vector<QPointF> &lines = tileTrailLines[static_cast<size_t>(tile)];
+    std::vector<QRgb> &colours = tileTrailColours[static_cast<size_t>(tile)];
+    size_t run = 0;
+    for (size_t i = 1; i <= colours.size(); i++) {
+        if (i == colours.size() || colours[i] != colours[run]) {
+            p.setPen(QColor::fromRgba(colours[run]));
+            p.drawLines(&lines[run * 2], static_cast<int>(i - run));
+            run = i;
+        }
+    }
+    // Everything else is written straight into the frame's memory
+    p.end();
+
+    if (drawHeatmap) {
+        renderHeatTile(tile);
+        return;
+    }
+
+    // Draw the points straight into the frame's memory
+    std::vector<PointDraw> &points = tilePoints[static_cast<size_t>(tile)];
+    for (std::vector<PointDraw>::iterator iter = points.begin(), end = points.end(); iter != end; ++iter) {
+        for (int y = std::max(iter->y, y0); y < std::min(iter->y + iter->size, y0 + height); y++) {
+            QRgb *line = reinterpret_cast<QRgb*>(frameBits + y * frameStride);
+            for (int x = std::max(iter->x, x0); x < std::min(iter->x + iter->size, x0 + width); x++) {
+                line[x] = iter->colour;
+            }
+        }
+    }
+
+    // Draw stars and black holes beneath the planets and asteroids around them
+    std::vector<SpriteDraw> &draws = tileSprites[static_cast<size_t>(tile)];
+    std::stable_sort(draws.begin(), draws.end(),
+                     [](const SpriteDraw &a, const SpriteDraw &b) { return a.sprite > b.sprite; });
+    QRect clip(x0, y0, width, height);
+    for (std::vector<SpriteDraw>::iterator iter = draws.begin(), end = draws.end(); iter != end; ++iter) {
+        const QImage &mip = mips[iter->sprite][iter->level];
+        // Mips are only ever shrunk by less than half, so the nearest pixel
+        // is good enough unless the sprite is being enlarged
+        Blitter::Sampling sampling = iter->target.width() > mip.width() ? Blitter::Bilinear : Blitter::Nearest;
+        Blitter::blit(frameBits, frameStride, clip, mip, iter->target, sampling);
+    }
+}
+
+/**
+ * @brief Renderer::accumulateHeatTile Adds up the weight of the bodies at
+ * each pixel of one tile of the heatmap, and finds the tile's highest.
+ * @param tile Index of the tile, counting from top left to bottom right
+ */
+void Renderer::accumulateHeatTile(int tile) {
+    int x0 = (tile % tilesX) * TILE_SIZE;
+    int y0 = (tile / tilesX) * TILE_SIZE;
+    int width = std::min(TILE_SIZE, view.width - x0);
+    int height = std::min(TILE_SIZE, view.height - y0);
+    for (int y = y0; y < y0 + height; y++) {
+        std::fill(heat.begin() + (y * view.width + x0), heat.begin() + (y * view.width + x0 + width), 0.0f);
+    }
+    float highest = 0;
+    std::vector<HeatPoint> &points = tileHeat[static_cast<size_t>(tile)];
+    for (std::vector<HeatPoint>::iterator iter = points.begin(), end = points.end(); iter != end; ++iter) {
+        float &total = heat[static_cast<size_t>(iter->y * view.width + iter->x)];
+        total += iter->weight;
+        highest = std::max(highest, total);
+    }
+    tileHeatMax[static_cast<size_t>(tile)] = highest;
+}
+
+/**
+ * @brief Renderer::renderHeatTile Draws one tile of the heatmap over the
+ * background. The weights are put on a log scale so that sparse areas still
+ * show up next to dense ones, then coloured using heatRamp.
+ * @param tile Index of the tile, counting from top left to bottom right
+ */
+void Renderer::renderHeatTile(int tile) {
+    if (heatMax <= 0) return;
+    int x0 = (tile % tilesX) * TILE_SIZE;
+    int y0 = (tile / tilesX) * TILE_SIZE;
+    int width = std::min(TILE_SIZE, view.width - x0);
+    int height = std::min(TILE_SIZE, view.height - y0);
+    float rampScale = 255.0f / log1pf(heatMax);
+    for (int y = y0; y < y0 + height; y++) {
+        const float *weights = &heat[static_cast<size_t>(y * view.width)];
+        QRgb *line = reinterpret_cast<QRgb*>(frameBits + y * frameStride);
+        for (int x = x0; x < x0 + width; x++) {
+            if (weights[x] <= 0) continue;
+            int index = std::min(static_cast<int>(log1pf(weights[x]) * rampScale), 255);
+            line[x] = Blitter::blend(heatRamp[index], line[x]);
+        }
+    }
+}
+
+/**
+ * @brief Renderer::renderRocket Draws the player controlled rocket, or its
+ * explosion, over the finished tiles.
+ */
+void Renderer::renderRocket() {
+    QPainter p(&backFrame);
+    p.setRenderHint(QPainter::Antialiasing);
+    double bodyDiam = rocket.getDiameter();
+    // Move the painter to the coordinates of the rocket
+    // (We want the centre of any rotation to be the centre of the rocket)
+    double rocketX = rocket.getPrevX() + (rocket.getX() - rocket.getPrevX()) * view.interpolation;
+    double rocketY = rocket.getPrevY() + (rocket.getY() - rocket.getPrevY()) * view.interpolation;
+    p.translate(view.scale * (rocketX - view.left), view.scale * (rocketY - view.top));
+
+    if (rocket.isExploding()) {
+        // Draw the explosion animation (slowed down 4x), until it has finished
+        int frame = rocket.getExplodingCount() / 4;
+        if (frame < static_cast<int>(explosionFrames.size())) {
+            int size = static_cast<int>(2 * bodyDiam * view.scale);
+            const QImage &image = explosionFrames[static_cast<size_t>(frame)];
+            p.drawImage(QRect(static_cast<int>(-bodyDiam * view.scale),
+                              static_cast<int>(-bodyDiam * view.scale),
+                              size, size),
+                        sprites.getMip(image, Sprites::getMipLevel(image.size(), size)));
+        }
+    } else {
+        // Rotate the painter so we can draw the rocket at the correct angle
+        p.rotate(rocket.getAngle());
+        // Choose the correct sprite based on whether or not the rocket is firing
+        const QImage &image = spriteImages[rocket.isFiring() ? Sprites::RocketFiringSprite : Sprites::RocketIdleSprite];
+        int size = static_cast<int>(bodyDiam * view.scale);
+        p.drawImage(QRect(static_cast<int>((-bodyDiam / 2.0) * view.scale),
+                          static_cast<int>((-bodyDiam / 2.0) * view.scale),
+                          size, size),
+                    sprites.getMip(image, Sprites::getMipLevel(image.size(), size)));
+    }
+}
@@ -0,0 +1,161 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <QImage>
+#include "body.h"
+#include "rocket.h"
+#include "sprites.h"
+#include "workerpool.h"
+#include "trailpool.h"
+#include "simulation.h"
+
+/*
+ * Draws snapshots of the simulation's bodies into images on its own thread,
+ * so the GUI thread only has to draw the finished frame. The frame is split
+ * into square tiles which are drawn in parallel by a worker pool. Everything
+ * is drawn with images rather than pixmaps, since pixmaps can only be used
+ * on the GUI thread. Each view of the simulation has its own renderer, with
+ * its own camera, culling and level of detail, but they all draw the same
+ * shared snapshot.
+ */
+class Renderer {
+public:
+    // What should be drawn, and where the camera is
+    struct View {
+        // Size of the frame in pixels
+        int width = 0;
+        int height = 0;
+        // Pixels per unit of distance in the simulation
+        double scale = 1;
+        // Simulation coordinates of the top left corner of the frame
+        double left = 0;
+        double top = 0;
+        // Position on screen of one of the background tiles
+        double backgroundX = 0;
+        double backgroundY = 0;
+        // Scale the background is drawn at
+        double backgroundScale = 1;
+        // Should the player controlled rocket be drawn?
+        bool drawRocket = false;
+        // Where to draw bodies between their previous position (0) and
+        // current position (1). Above 1 extrapolates
+        double interpolation = 1;
+
+        bool operator==(const View &other) const {
+            return width == other.width && height == other.height && scale == other.scale &&
+                    left == other.left && top == other.top && backgroundX == other.backgroundX &&
+                    backgroundY == other.backgroundY && backgroundScale == other.backgroundScale &&
+                    drawRocket == other.drawRocket && interpolation == other.interpolation;
+        }
+    };
+
+    Renderer(Sprites sprites);
+    ~Renderer();
+    void requestFrame(const std::shared_ptr<Simulation::Snapshot> &snapshot, const Rocket &rocket, const View &view);
+    bool takeFrame(QImage &frame);
+    void waitForFrame(QImage &frame);
+    bool isBusy();
+    void setHeatmapSettings(int threshold, bool byMass);
+
+private:
+    // A body to be drawn with its sprite, in screen coordinates
+    struct SpriteDraw {
+        QRectF target;
+        int sprite;
+        int level;
+    };
+    // A body to be drawn as a point, in screen coordinates
+    struct PointDraw {
+        int x;
+        int y;
+        int size;
+        QRgb colour;
+    };
+    // A body adding to the heatmap, in screen coordinates
+    struct HeatPoint {
+        int x;
+        int y;
+        float weight;
+    };
+
+    void work();
+    void render();
+    void renderTile(int tile);
+    void accumulateHeatTile(int tile);
+    void renderHeatTile(int tile);
+    void binTrails();
+    void renderRocket();
+
+    std::thread thread;
+    std::mutex mut;
+    // Signalled when a frame is requested, or the renderer is stopping
+    std::condition_variable wake;
+    // Signalled when a frame has been finished
+    std::condition_variable frameDone;
+    bool frameRequested = false;
+    // Is a frame being drawn?
+    bool rendering = false;
+    bool stopping = false;
+    WorkerPool *workers;
+
+    // Only used by the render thread, apart from being copied when created
+    Sprites sprites;
+    QImage spriteImages[Sprites::NumSprites];
+    QImage backgroundImage;
+    std::vector<QImage> explosionFrames;
+    // The background scaled to backgroundTileScale
+    QImage backgroundTile;
+    double backgroundTileScale = 0;
+    // Colours of the heatmap from least to most dense, premultiplied
+    QRgb heatRamp[256];
+
+    // The latest frame requested, guarded by mut
+    std::shared_ptr<Simulation::Snapshot> requestedSnapshot;
+    Rocket requestedRocket;
+    View requestedView;
+    int requestedHeatmapThreshold;
+    bool requestedHeatmapByMass = false;
+    // The frame being drawn. The snapshot is let go once it has been drawn,
+    // so the simulation can reuse its memory
+    std::shared_ptr<Simulation::Snapshot> snapshot;
+    Rocket rocket;
+    View view;
+    // Above this many bodies on screen, their density is drawn as a heatmap
+    // rather than drawing each body
+    int heatmapThreshold;
+    // Should the heatmap show mass rather than number of bodies?
+    bool heatmapByMass = false;
+    QImage backFrame;
+    // The last finished frame, guarded by mut
+    QImage readyFrame;
+    bool frameReady = false;
+
+    // Tiles of the frame being drawn, and what must be drawn in each
+    int tilesX = 0;
+    int tilesY = 0;
+    std::vector<std::vector<SpriteDraw> > tileSprites;
+    std::vector<std::vector<PointDraw> > tilePoints;
+    // Line segments of the trails, as pairs of screen positions, with the
+    // colour of each segment
+    std::vector<std::vector<QPointF> > tileTrailLines;
+    std::vector<std::vector<QRgb> > tileTrailColours;
+    // Whether this frame is drawn as a heatmap, the bodies adding to each
+    // tile of it, and the total weight at every pixel
+    bool drawHeatmap = false;
+    std::vector<std::vector<HeatPoint> > tileHeat;
+    std::vector<float> heat;
+    // Highest total weight of any pixel in each tile, and in the frame
+    std::vector<float> tileHeatMax;
+    float heatMax = 0;
+    // Every mip used by this frame. Copies, so they stay valid even if the
+    // cache drops them
+    QImage mips[Sprites::NumSprites][Sprites::NumMipLevels];
+    uchar *frameBits = nullptr;
+    int frameStride = 0;
+};
+
+#endif // RENDERER_H
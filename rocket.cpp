@@ -1,9 +1,23 @@
 #include <cmath>
 #include <iostream>
 #include "rocket.h"
+#include "pool.h"
 
 #define MASS 5
 #define DIAMETER 5
+// How many rockets to allocate from the heap at once
+#define ROCKETS_PER_CHUNK 16
+
+/**
+ * @brief rocketPool Returns the pool which all rockets are allocated from.
+ * The pool is never destroyed, since the simulation thread may still be
+ * using the rocket while the program exits.
+ * @return The pool for Rocket objects
+ */
+static Pool& rocketPool() {
+    static Pool *pool = new Pool(sizeof(Rocket), ROCKETS_PER_CHUNK);
+    return *pool;
+}
 
 /**
  * @brief Rocket::Rocket Create a new rocket with uninitialised position and
@@ -12,8 +26,8 @@
 Rocket::Rocket() {
     mass = MASS;
     diameter = DIAMETER;
-    pos = new Vector(-1, -1);
-    vel = new Vector(-1, -1);
+    pos = Vector(-1, -1);
+    vel = Vector(-1, -1);
     type = PlayerRocket;
     active = true;
 }
@@ -24,22 +38,24 @@ Rocket::Rocket() {
  * @param pos The rocket's position Vector
  * @param vel The rocket's velocity Vector
  */
-Rocket::Rocket(Vector *pos, Vector *vel) {
+Rocket::Rocket(Vector pos, Vector vel) {
     mass = MASS;
     diameter = DIAMETER;
     this->pos = pos;
+    this->prevPos = pos;
     this->vel = vel;
     type = PlayerRocket;
     active = true;
 }
 
 
-Rocket::Rocket(Vector *pos, Vector *vel, bool firing, bool exploding,
+Rocket::Rocket(Vector pos, Vector vel, bool firing, bool exploding,
                int explodingCount, bool rotatingAntiCW, bool rotatingCW,
                int angle) {
     mass = MASS;
     diameter = DIAMETER;
     this->pos = pos;
+    this->prevPos = pos;
     this->vel = vel;
     type = PlayerRocket;
     active = true;
@@ -53,6 +69,32 @@ Rocket::Rocket(Vector *pos, Vector *vel, bool firing, bool exploding,
 
 
 
+/**
+ * @brief Rocket::operator new Allocates memory for a Rocket from the rocket
+ * pool.
+ * @param size Size of the object being allocated
+ * @return Memory for the new Rocket
+ */
+void* Rocket::operator new(size_t size) {
+    if (size > rocketPool().getBlockSize()) {
+        return ::operator new(size);
+    }
+    return rocketPool().allocate();
+}
+
+/**
+ * @brief Rocket::operator delete Returns a Rocket's memory to the rocket pool.
+ * @param p The memory to release
+ * @param size Size of the object being deleted
+ */
+void Rocket::operator delete(void *p, size_t size) {
+    if (size > rocketPool().getBlockSize()) {
+        ::operator delete(p);
+    } else {
+        rocketPool().release(p);
+    }
+}
+
 /**
  * @brief Rocket::isFiring Are the rocket's engines firing?
  * @return True if the rocket's engines are firing
@@ -198,7 +240,7 @@ void Rocket::accelerate() {
         velocityVector.setY(-velocity * cos(angleRadians));
 
         // Add new velocity vector to current velocity vector
-        vel->add(&velocityVector);
+        vel.add(&velocityVector);
     }
 }
 
@@ -208,7 +250,7 @@ void Rocket::accelerate() {
  * @return A copy of this Rocket
  */
 Rocket* Rocket::copy() {
-    return new Rocket(pos->copy(), vel->copy(), firing, exploding,
+    return new Rocket(pos, vel, firing, exploding,
                       explodingCount, rotatingAntiCW, rotatingCW,
                       angle);
 }
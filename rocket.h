@@ -6,11 +6,15 @@
 class Rocket : public Body {
 public:
     Rocket();
-    Rocket(Vector *pos, Vector *vel);
-    Rocket(Vector *pos, Vector *vel, bool firing, bool exploding,
+    Rocket(Vector pos, Vector vel);
+    Rocket(Vector pos, Vector vel, bool firing, bool exploding,
            int explodingCount, bool rotatingAntiCW, bool rotatingCW,
            int angle);
 
+    // Rockets have their own pool, since they are larger than a Body
+    static void* operator new(size_t size);
+    static void operator delete(void *p, size_t size);
+
     bool isFiring();
     void setFiring(bool firing);
     bool isExploding();
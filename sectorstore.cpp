@@ -0,0 +1,175 @@
+#include <iostream>
+#include "sectorstore.h"
+
+// Pages to add to the file each time it runs out
+#define PAGES_PER_GROWTH 256
+
+/**
+ * @brief SectorStore::SectorStore Creates an empty store. The page file is
+ * created in the system's temporary directory and removed when the store
+ * is destroyed.
+ */
+SectorStore::SectorStore() {
+    if (!file.open()) {
+        std::cout << "Couldn't create sector page file, far sectors will stay in memory" << std::endl;
+        failed = true;
+    }
+}
+
+/**
+ * @brief SectorStore::~SectorStore Destructor. Unmaps and removes the page file.
+ */
+SectorStore::~SectorStore() {
+    if (pages) file.unmap(reinterpret_cast<uchar*>(pages));
+}
+
+/**
+ * @brief SectorStore::store Moves the given bodies of a sector into the page
+ * file. The bodies themselves are left for the caller to delete. A sector
+ * can be stored more than once before it is loaded.
+ * @param sector The sector the bodies are in
+ * @param sectorBodies The bodies to store
+ * @param numBodies How many bodies there are
+ * @param origin World position of the origin the bodies' positions are
+ * relative to
+ * @param tick The current tick, for fast-forwarding the bodies when loaded
+ * @return True if the bodies were stored, false if there was no room for them
+ */
+bool SectorStore::store(uint64_t sector, Body **sectorBodies, int numBodies, QPointF origin, long long tick) {
+    // Make sure there is room for all of the bodies before storing any
+    size_t pagesNeeded = static_cast<size_t>((numBodies + SECTOR_PAGE_BODIES - 1) / SECTOR_PAGE_BODIES);
+    while (freePages.size() < pagesNeeded) {
+        if (!grow()) return false;
+    }
+    std::vector<int> &sectorPages = index[sector];
+    Page *page = nullptr;
+    for (int i = 0; i < numBodies; i++) {
+        if (!page || page->numBodies == SECTOR_PAGE_BODIES) {
+            int newPage = freePages.back();
+            freePages.pop_back();
+            sectorPages.push_back(newPage);
+            page = &pages[newPage];
+            page->numBodies = 0;
+            page->tick = tick;
+        }
+        Body *b = sectorBodies[i];
+        BodyRecord &record = page->bodies[page->numBodies++];
+        record.mass = b->getMass();
+        record.diameter = b->getDiameter();
+        record.x = b->getX() + origin.x();
+        record.y = b->getY() + origin.y();
+        record.velX = b->getVelX();
+        record.velY = b->getVelY();
+        record.type = b->getType();
+        record.planetType = b->getPlanetType();
+    }
+    return true;
+}
+
+/**
+ * @brief SectorStore::contains Finds whether any bodies of the given sector
+ * are stored.
+ * @param sector The sector to look for
+ * @return True if the sector has stored bodies
+ */
+bool SectorStore::contains(uint64_t sector) {
+    return index.find(sector) != index.end();
+}
+
+/**
+ * @brief SectorStore::load Makes new bodies from everything stored for the
+ * given sector, and removes the sector from the store.
+ * @param sector The sector to load
+ * @param origin World position of the origin the new bodies' positions
+ * should be relative to
+ * @param tick The current tick
+ * @param fastForward If true, bodies stored together are moved as a group
+ * by their average velocity for as many ticks as they were stored, so a
+ * drifting system carries on from where it would have got to. Bodies stored
+ * by the same call to store() are one group, even if they fill several pages
+ * @param loaded The new bodies are added to the end of this list
+ */
+void SectorStore::load(uint64_t sector, QPointF origin, long long tick, bool fastForward, std::vector<Body*> &loaded) {
+    std::unordered_map<uint64_t, std::vector<int> >::iterator found = index.find(sector);
+    if (found == index.end()) return;
+    std::vector<int> &sectorPages = found->second;
+    size_t groupStart = 0;
+    while (groupStart < sectorPages.size()) {
+        // The pages written by one call to store() are next to each other
+        // in the list, and were stored at the same tick
+        long long groupTick = pages[sectorPages[groupStart]].tick;
+        size_t groupEnd = groupStart;
+        double totalMass = 0, momentumX = 0, momentumY = 0;
+        while (groupEnd < sectorPages.size() && pages[sectorPages[groupEnd]].tick == groupTick) {
+            // Average velocity weighted by mass, i.e. the velocity of the
+            // group's centre of mass, so orbits within it are unaffected
+            Page &page = pages[sectorPages[groupEnd++]];
+            for (int i = 0; i < page.numBodies; i++) {
+                totalMass += page.bodies[i].mass;
+                momentumX += page.bodies[i].mass * page.bodies[i].velX;
+                momentumY += page.bodies[i].mass * page.bodies[i].velY;
+            }
+        }
+        double shiftX = -origin.x(), shiftY = -origin.y();
+        if (fastForward && totalMass > 0) {
+            shiftX += momentumX / totalMass * (tick - groupTick);
+            shiftY += momentumY / totalMass * (tick - groupTick);
+        }
+        for (size_t p = groupStart; p < groupEnd; p++) {
+            Page &page = pages[sectorPages[p]];
+            for (int i = 0; i < page.numBodies; i++) {
+                BodyRecord &record = page.bodies[i];
+                loaded.push_back(new Body(record.mass, record.diameter,
+                                          Vector(record.x + shiftX, record.y + shiftY),
+                                          Vector(record.velX, record.velY),
+                                          static_cast<Body::BodyType>(record.type), record.planetType));
+            }
+            freePages.push_back(sectorPages[p]);
+        }
+        groupStart = groupEnd;
+    }
+    index.erase(found);
+}
+
+/**
+ * @brief SectorStore::clear Removes every stored sector. The page file keeps
+ * its size so its pages can be reused.
+ */
+void SectorStore::clear() {
+    index.clear();
+    freePages.clear();
+    for (int i = numPages - 1; i >= 0; i--) {
+        freePages.push_back(i);
+    }
+}
+
+/**
+ * @brief SectorStore::grow Adds PAGES_PER_GROWTH pages to the end of the
+ * page file and maps it again.
+ * @return True if the file was grown
+ */
+bool SectorStore::grow() {
+    if (failed) return false;
+    if (pages) file.unmap(reinterpret_cast<uchar*>(pages));
+    pages = nullptr;
+    int newNumPages = numPages + PAGES_PER_GROWTH;
+    qint64 size = static_cast<qint64>(newNumPages) * static_cast<qint64>(sizeof(Page));
+    uchar *mapped = nullptr;
+    if (file.resize(size)) mapped = file.map(0, size);
+    if (!mapped) {
+        std::cout << "Couldn't grow sector page file: " << file.errorString().toStdString() << std::endl;
+        failed = true;
+        // Pages already written are lost, so forget about them
+        index.clear();
+        freePages.clear();
+        numPages = 0;
+        return false;
+    }
+    pages = reinterpret_cast<Page*>(mapped);
+    // Use the lowest new page first
+    for (int i = newNumPages - 1; i >= numPages; i--) {
+        freePages.push_back(i);
+    }
+    numPages = newNumPages;
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef SECTORSTORE_H
+#define SECTORSTORE_H
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <QTemporaryFile>
+#include <QPointF>
+#include "body.h"
+
+// Most bodies each page of the page file can hold
+#define SECTOR_PAGE_BODIES 63
+
+/*
+ * Keeps the bodies of sectors far from the player in a memory-mapped page
+ * file rather than in the simulation, so that memory and tick time stay the
+ * same however far the player travels. Sectors are identified by the value
+ * from Simulation::sectorId(). Not thread safe.
+ */
+class SectorStore {
+public:
+    SectorStore();
+    ~SectorStore();
+    bool store(uint64_t sector, Body **sectorBodies, int numBodies, QPointF origin, long long tick);
+    bool contains(uint64_t sector);
+    void load(uint64_t sector, QPointF origin, long long tick, bool fastForward, std::vector<Body*> &loaded);
+    void clear();
+
+private:
+    // Everything needed to make a body again, in world coordinates
+    struct BodyRecord {
+        double mass;
+        double diameter;
+        double x, y;
+        double velX, velY;
+        int32_t type;
+        int32_t planetType;
+    };
+
+    // Bodies stored from one sector at one time
+    struct Page {
+        int32_t numBodies;
+        int32_t unused;
+        int64_t tick; // When the bodies were stored
+        BodyRecord bodies[SECTOR_PAGE_BODIES];
+    };
+
+    bool grow();
+
+    QTemporaryFile file;
+    Page *pages = nullptr; // The mapped file
+    int numPages = 0;
+    std::vector<int> freePages;
+    // Pages holding each stored sector
+    std::unordered_map<uint64_t, std::vector<int> > index;
+    bool failed = false; // Couldn't create or map the file
+};
+
+#endif // SECTORSTORE_H
@@ -2,16 +2,45 @@
 #include <chrono>
 #include <iostream>
 #include <cmath>
+#include <random>
+#include <algorithm>
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 #include "simulation.h"
 #include "simulationwidget.h"
 
-#define MAX_SYSTEM_ORBIT_RADIUS 300
-#define MIN_SYSTEM_ORBIT_RADIUS 75
-#define MAX_PLANET_ORBIT_RADIUS 20
 // How scaled down the map is compared to the user's view
 #define MAP_SCALE 100.0
-// How many bodies each thread should handle in a tick
+// How many bodies each task handles in a tick (tasks are shared between threads)
 #define BODIES_PER_THREAD 50
+// How often the generator looks for new systems to spawn if not asked sooner (ms)
+#define GENERATION_INTERVAL 160
+// How far ahead of the rocket systems are generated, in ticks at its current velocity
+#define GENERATION_LOOKAHEAD_TICKS 120
+// Width and height of each sector of the universe, which holds at most one system
+#define SECTOR_SIZE 1500
+// Chance of each sector having a planetary system
+#define SECTOR_SYSTEM_CHANCE 0.5
+// How often far sectors are moved out of the simulation (ticks)
+#define EVICTION_INTERVAL 60
+// How many sectors beyond the streaming region bodies must be before they
+// are moved out, so that sectors on its edge don't go back and forth
+#define EVICTION_MARGIN 3
+// Gaps between ticks longer than this many milliseconds aren't counted
+// when measuring the tick rate
+#define MAX_TICK_INTERVAL 250
+// Default number of positions kept for each body's trail
+#define TRAIL_LENGTH 128
+// Default number of ticks between the positions in a trail
+#define TRAIL_INTERVAL 4
+// Most bodies which can have a trail at once
+#define MAX_TRAILS 4096
+// Most old snapshots kept for their memory to be reused. More are made while
+// many views are drawing at once, but those are freed when they are done
+#define SNAPSHOT_POOL_SIZE 8
 
 /**
  * @brief Simulation::Simulation Initialises the class, adds a star and two
@@ -20,10 +49,23 @@
 Simulation::Simulation(Sprites sprites) {
     this->sprites = sprites;
     visibleRegion = new QRect(0, 0, 100, 100);
+    minimap = new Minimap(MAP_SCALE);
+    trailLength = TRAIL_LENGTH;
+    trailInterval = TRAIL_INTERVAL;
+    // Reference implementations of each part of a tick
+    forceSolver = new BruteForceSolver();
+    collisionDetector = new SpriteCollisionDetector(sprites);
+    integrator = new EulerIntegrator();
+    // The simulation thread works on ticks too, so leave one core for it
+    int numWorkers = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+    workers = new WorkerPool(numWorkers > 0 ? numWorkers : 0);
+    universeGenerator = new UniverseGenerator(workers);
     // Add central star to list of bodies
     std::cout << "Starting simulation... ";
     std::thread t(&Simulation::run, this);
     t.detach();
+    std::thread generator(&Simulation::generate, this);
+    generator.detach();
     std::cout << "Simulation started" << std::endl;
 }
 
@@ -32,8 +74,16 @@ Simulation::Simulation(Sprites sprites) {
  */
 Simulation::~Simulation() {
     delete visibleRegion;
-    if (exploredMap) delete exploredMap;
     deleteBodies();
+    delete minimap;
+    delete forceSolver;
+    delete collisionDetector;
+    delete integrator;
+    delete pendingForceSolver;
+    delete pendingCollisionDetector;
+    delete pendingIntegrator;
+    delete universeGenerator;
+    delete workers;
 }
 
 /**
@@ -42,91 +92,61 @@ Simulation::~Simulation() {
  */
 void Simulation::deleteBodies() {
     mut.lock();
-    for (std::list<Body*>::iterator iter = bodies.begin(); iter != bodies.end(); ++iter) {
+    for (std::vector<Body*>::iterator iter = bodies.begin(); iter != bodies.end(); ++iter) {
         delete *iter;
     }
+    bodies.clear();
+    for (std::vector<Body*>::iterator iter = pendingBodies.begin(); iter != pendingBodies.end(); ++iter) {
+        delete *iter;
+    }
+    pendingBodies.clear();
+    // The rocket was one of the bodies
+    rocket = nullptr;
+    sectorStore.clear();
+    systemIndex.clear();
+    trails.clear();
+    // Anything the generator is working on is from before the reset
+    resetCount++;
+    version++;
     mut.unlock();
-    bodies.erase(bodies.begin(), bodies.end());
 }
 
 /**
- * @brief Simulation::resetSim Resets the simulation to default settings.
- * Removes all bodies and adds in the inital three.
+ * @brief Simulation::resetSim Resets the simulation to default settings,
+ * in a new random universe. Removes all bodies and adds in the inital three.
  */
 void Simulation::resetSim() {
+    std::random_device device;
+    resetSim((static_cast<uint64_t>(device()) << 32) | device());
+}
+
+/**
+ * @brief Simulation::resetSim Resets the simulation to default settings.
+ * Removes all bodies and adds in the inital three. The same seed always
+ * gives the same universe to explore.
+ * @param newSeed The seed of the universe
+ */
+void Simulation::resetSim(uint64_t newSeed) {
     // Delete current bodies list
     deleteBodies();
     scale = 1;
     G = G_DEFAULT;
+    mut.lock();
+    origin = QPointF(0, 0);
+    version++;
+    seed = newSeed;
+    generatedSectors.clear();
+    // The initial system takes the place of the centre sector's
+    generatedSectors.insert(sectorId(0, 0));
+    mut.unlock();
     // Spawn initial planetary system in the centre of the screen, along
     // with a player-controlled rocket if we are in the Exploration mode
     spawnPlanetarySystem(0, 0, 0, 0, mode == Exploration);
 
-    // Create new, empty map
-    if (exploredMap) delete exploredMap;
-    exploredMap = new QImage(1000, 1000, QImage::Format_ARGB32_Premultiplied);
-    exploredMap->fill(QColor(255,255,255));
-    mapDimensions.setRect(-500, -500, 1000, 1000);
-    mapOffset.setX(0);
-    mapOffset.setY(0);
-}
-
-/**
- * @brief Simulation::calculateOrbitVelocity Spawns the given newBody at a
- * random distance away from central, according to maxOrbitDistance, then
- * calculates the velocity required to stay in orbit. The calculate position
- * and velocity Vectors are placed into the given newBody body.
- * @param newBody The body to place around central and calculate its orbit
- * velocity
- * @param central The body which newBody orbits
- * @param maxOrbitDistance The maximum distance from central that newBody
- * should be placed at
- */
-void Simulation::calculateOrbitVelocity(Body *newBody, Body *central, int maxOrbitDistance) {
-    double x = central->getX();
-    double y = central->getY();
-    double centralDiam;
-    if (central->getType() == Body::Star || central->getType() == Body::WhiteDwarf) {
-        centralDiam = MIN_SYSTEM_ORBIT_RADIUS;
-    } else if (central->getType()== Body::BlackHole) {
-        centralDiam = MIN_SYSTEM_ORBIT_RADIUS * 2;
-    } else {
-        centralDiam = central->getDiameter();
-    }
-    double centralMass = central->getMass();
-    Vector centralPos = central->getPos();
-    // Max distance should depend on central body?
-    // Longer for black hole since its gravitational pull is stronger --> Able to keep in orbit further?
-    double newX = x + rand() % (2 * maxOrbitDistance) - maxOrbitDistance;
-    double newY = y + rand() % (2 * maxOrbitDistance) - maxOrbitDistance;
-    // Centre of newBody must not overlap with the central body
-    // (and we want there to be at least a little bit of space between)
-    while (pow(newX - x, 2) + pow(newY - y, 2) < pow(centralDiam, 2)) {
-        newX = x + rand() % (2 * maxOrbitDistance) - maxOrbitDistance;
-        newY = y + rand() % (2 * maxOrbitDistance) - maxOrbitDistance;
-    }
-    newBody->setPos(newX, newY);
-    Vector *newBodyPos = newBody->getPos();
-    // Calculate velocity of newBody
-    // v = sqrt( (G * centralMass) / radius of orbit )
-    double vel = sqrt((G * centralMass) / centralPos.distance(newBodyPos));
-    double distX = newX - centralPos.getX();
-    double distY = newY - centralPos.getY();
-    // Use trig to find the magnitude of the velocity in the x and y directions
-    // theta = tan^-1 (|distY| / |distX|)
-    double theta = tanh(distY / distX);
-    // velX = vel * sin(theta)
-    double velX = vel * sin(theta);
-    // velY = vel * cos(theta)
-    double velY = vel * cos(theta);
-    // Flip one of velX or velY to make the newBody go in the correct direction
-    // (but we don't mind whether they're going clockwise or anticlockwise)
-    if (rand() % 2 == 0) {
-        velX = -velX;
-    } else {
-        velY = -velY;
-    }
-    newBody->setVel(central->getVelX() + velX, central->getVelY() + velY);
+    // Start with an empty map
+    mut.lock();
+    exploredMap.clear();
+    mut.unlock();
 }
 
 /**
@@ -140,45 +160,30 @@ void Simulation::calculateOrbitVelocity(Body *newBody, Body *central, int maxOrb
  * planetary system to be spawned
  */
 void Simulation::spawnPlanetarySystem(Body* central, bool spawnRocket) {
-    std::list<Body*> newPlanets;
-    std::list<Body*> newAsteroids;
-    Body *newPlanet;
-    Body *newAsteroid;
-    int numAsteroids;
-
-    // Generate between 2 and 5 planets around the central body
-    int numPlanets = 2 + std::rand() % 4;
-    for (int i = 0; i < numPlanets; i++) {
-        newPlanet = new Body(Body::Planet);
-        calculateOrbitVelocity(newPlanet, central, MAX_SYSTEM_ORBIT_RADIUS);
-        newPlanets.push_back(newPlanet);
-
-        if (spawnRocket && i == 0 && mode == Exploration) {
-            // Spawn Rocket rather than asteroids
-            rocket = new Rocket();
-            calculateOrbitVelocity(rocket, newPlanet, MAX_PLANET_ORBIT_RADIUS);
-        } else {
-            // Generate between 0 and 5 asteroids for this planet
-            numAsteroids = rand() % 6;
-            for (int j = 0; j < numAsteroids; j++) {
-                newAsteroid = new Body(Body::Asteroid);
-                calculateOrbitVelocity(newAsteroid, newPlanet, MAX_PLANET_ORBIT_RADIUS);
-                newAsteroids.push_back(newAsteroid);
-            }
-        }
-    }
-    // Add bodies to simulation
+    // Systems spawned by the user don't need to be repeatable
+    Random random(static_cast<uint64_t>(std::rand()));
+    spawnPlanetarySystem(central, spawnRocket, random);
+}
+
+/**
+ * @brief Simulation::spawnPlanetarySystem Spawns a planetary system with
+ * the centre being the given central body, using the given generator.
+ * @param central The central body of the system
+ * @param spawnRocket Should a player-controlled rocket be spawned with
+ * this planetary system?
+ * @param random Generator for the planets and asteroids
+ */
+void Simulation::spawnPlanetarySystem(Body *central, bool spawnRocket, Random &random) {
+    // Generated straight onto the end of the bodies list, which is quick
+    // enough for one system that the tick needn't wait long
     mut.lock();
-    if (spawnRocket && mode == Exploration) {
-        bodies.push_back(rocket);
-    }
-    bodies.push_back(central);
-    for (std::list<Body*>::iterator iter = newPlanets.begin(), end = newPlanets.end(); iter != end; ++iter) {
-        bodies.push_back(*iter);
-    }
-    for (std::list<Body*>::iterator iter = newAsteroids.begin(), end = newAsteroids.end(); iter != end; ++iter) {
-        bodies.push_back(*iter);
+    size_t first = bodies.size();
+    UniverseGenerator::generateSystem(central, UniverseParams(), G, spawnRocket && mode == Exploration,
+                                      random, bodies);
+    for (size_t i = first; i < bodies.size(); i++) {
+        if (bodies[i]->getType() == Body::PlayerRocket) rocket = static_cast<Rocket*>(bodies[i]);
     }
+    version++;
     mut.unlock();
 }
 
@@ -188,6 +193,7 @@ void Simulation::spawnPlanetarySystem(Body* central, bool spawnRocket) {
  * The central celestial body is randomly chosen between a star, dwarf star
  * or black hole. A random number of planets are then spawned in orbit
  * around this body, with a random number of asteroids orbiting those planets.
+ * The system is decided by the seed of the universe.
  * @param x x-coordinate of the centre of the planetary system
  * @param y y-coordinate of the centre of the planetary system
  * @param dx x velocity of the planetary system
@@ -197,107 +203,262 @@ void Simulation::spawnPlanetarySystem(Body* central, bool spawnRocket) {
  * planetary system to be spawned
  */
 void Simulation::spawnPlanetarySystem(double x, double y, double dx, double dy, bool spawnRocket) {
+    Random random(seed);
     // Central body - Type 2 (star), 3 (dwarf star) or 4 (black hole)
-    Body *central = new Body(static_cast<Body::BodyType>(2 + rand() % 3));
+    Body *central = new Body(static_cast<Body::BodyType>(2 + random.nextInt(3)), random);
     central->setPos(x, y);
     central->setVel(dx, dy);
 
-    spawnPlanetarySystem(central, spawnRocket);
+    spawnPlanetarySystem(central, spawnRocket, random);
+}
+
+/**
+ * @brief Simulation::generateSector Generates the contents of a sector of
+ * the universe. The universe is split into SECTOR_SIZE squares, each of which
+ * may have a planetary system, decided only by the seed and the sector's
+ * position. A sector can therefore be generated at any time, on any thread,
+ * and is the same every time. Systems are kept inside their own sector so
+ * they never overlap a neighbour's. Bodies are in world coordinates and are
+ * not added to the simulation.
+ * @param worldSeed The seed of the universe
+ * @param sectorX x-coordinate of the sector
+ * @param sectorY y-coordinate of the sector
+ * @param newBodies The bodies of the sector are added to the end of this
+ * list, central body first
+ */
+void Simulation::generateSector(uint64_t worldSeed, int sectorX, int sectorY, std::vector<Body*> &newBodies) {
+    Random random(Random::sectorKey(worldSeed, sectorX, sectorY));
+    if (random.nextDouble() >= SECTOR_SYSTEM_CHANCE) return;
+    // Leave room around the centre for the planets' orbits
+    double range = SECTOR_SIZE - 2 * MAX_SYSTEM_ORBIT_RADIUS;
+    double x = sectorX * SECTOR_SIZE - range / 2 + random.nextDouble() * range;
+    double y = sectorY * SECTOR_SIZE - range / 2 + random.nextDouble() * range;
+    UniverseGenerator::generateSystem(x, y, UniverseParams(), G, random, newBodies);
+}
+
+/**
+ * @brief Simulation::sectorId Packs the position of a sector into one value,
+ * for keeping track of which sectors have been generated.
+ * @param sectorX x-coordinate of the sector
+ * @param sectorY y-coordinate of the sector
+ * @return A value unique to the sector
+ */
+uint64_t Simulation::sectorId(int sectorX, int sectorY) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(sectorX)) << 32) | static_cast<uint32_t>(sectorY);
 }
 
 /**
  * @brief Simulation::spawnPlanetarySystem Handles the procedural generation
- * of planetary systems. Decides whether one or more new systems should be
- * spawned and randomly generates their velocities and a valid starting position.
- * The new systems are then generated and added to the simulation.
+ * of planetary systems. Generates every sector in the spawning region which
+ * hasn't been generated yet. The region is ahead of the rocket along its
+ * velocity, so that systems are ready before it gets there. The new systems
+ * are queued and added to the simulation at the start of the next tick.
+ * Systems which can't be added yet (they would be seen appearing, or would
+ * overlap another system) are thrown away, and their sectors are tried
+ * again later. Only called by the generator thread.
  */
 void Simulation::spawnPlanetarySystem() {
-    QRectF validSpawningRegion = calculateValidSpawningRegion();
-    double newX, newY;
-    Vector pos;
-    Body *central;
-
-    // 10 attempts when zoomed all the way in, 110 all the way out
-    int numAttempts = static_cast<int>((validSpawningRegion.width() *
-            validSpawningRegion.height()) / 400000.0);
-
-    for (int i = 0; i < numAttempts; i++) {
-        // New central body of the system
-        // Type 2 (star), 3 (dwarf star) or 4 (black hole)
-        // Calculate random pos, anywhere in the spawning region
-        newX = validSpawningRegion.x() + rand() % static_cast<int>(validSpawningRegion.width());
-        newY = validSpawningRegion.y() + rand() % static_cast<int>(validSpawningRegion.height());
-        pos = Vector(newX, newY);
-
-        // Calculate position on exploredMap and find if that pixel is blue (has been explored)
-        if (static_cast<QRgb>(
-                    exploredMap->pixel(
-                        static_cast<int>((mapOffset.x() + mapDimensions.x() +
-                                          mapDimensions.width()) + pos.getX() / MAP_SCALE),
-                        static_cast<int>((mapOffset.y() + mapDimensions.y() +
-                                          mapDimensions.height()) + pos.getY() / MAP_SCALE)))
-                == QRgb(qRgb(0,0,255))) {
-            // Area which we are trying to spawn at is invalid - it has been explored already
-            // -> Failed attempt, break
-            break;
+    // Nothing moves while paused, so nothing new can come into view
+    if (isPaused()) return;
+    // Decide which sectors to generate, so that the generation
+    // itself doesn't hold up the tick
+    mut.lock();
+    if (mode != Exploration || !rocket) {
+        mut.unlock();
+        return;
+    }
+    uint64_t genSeed = seed;
+    int genResetCount = resetCount;
+    QRectF validSpawningRegion = calculateStreamingRegion();
+    // Anything which could be seen right now, in world coordinates
+    QRectF view = QRectF(*visibleRegion).translated(origin);
+    int minX = static_cast<int>(floor(validSpawningRegion.left() / SECTOR_SIZE + 0.5));
+    int maxX = static_cast<int>(floor(validSpawningRegion.right() / SECTOR_SIZE + 0.5));
+    int minY = static_cast<int>(floor(validSpawningRegion.top() / SECTOR_SIZE + 0.5));
+    int maxY = static_cast<int>(floor(validSpawningRegion.bottom() / SECTOR_SIZE + 0.5));
+    sectorsToGenerate.clear();
+    for (int y = minY; y <= maxY; y++) {
+        for (int x = minX; x <= maxX; x++) {
+            if (generatedSectors.count(sectorId(x, y)) == 0) {
+                sectorsToGenerate.push_back(QPoint(x, y));
+            }
+        }
+    }
+    // Bring back sectors which were moved out of the simulation. One sector
+    // further out, so that systems split over two sectors come back together
+    for (int y = minY - 1; y <= maxY + 1; y++) {
+        for (int x = minX - 1; x <= maxX + 1; x++) {
+            if (sectorStore.contains(sectorId(x, y))) {
+                sectorStore.load(sectorId(x, y), origin, tickCount, fastForwardSectors, pendingBodies);
+            }
+        }
+    }
+    mut.unlock();
+
+    generatedBodies.clear();
+    generatedSystemSizes.clear();
+    generatedSystemSectors.clear();
+    emptySectors.clear();
+    for (std::vector<QPoint>::iterator iter = sectorsToGenerate.begin(), end = sectorsToGenerate.end(); iter != end; ++iter) {
+        size_t start = generatedBodies.size();
+        generateSector(genSeed, iter->x(), iter->y(), generatedBodies);
+        if (generatedBodies.size() == start) {
+            emptySectors.push_back(sectorId(iter->x(), iter->y()));
+            continue;
+        }
+        // Don't want a system to pop in suddenly where the user can see.
+        // Leave the sector to be tried again once it is out of sight
+        double x = generatedBodies[start]->getX(), y = generatedBodies[start]->getY();
+        if (view.intersects(QRectF(x - MAX_SYSTEM_ORBIT_RADIUS, y - MAX_SYSTEM_ORBIT_RADIUS,
+                                   2 * MAX_SYSTEM_ORBIT_RADIUS, 2 * MAX_SYSTEM_ORBIT_RADIUS))) {
+            for (size_t i = start; i < generatedBodies.size(); i++) delete generatedBodies[i];
+            generatedBodies.resize(start);
+            continue;
         }
+        generatedSystemSizes.push_back(static_cast<int>(generatedBodies.size() - start));
+        generatedSystemSectors.push_back(sectorId(iter->x(), iter->y()));
+    }
 
-        // Invalid if:
-            // Any part of the new system is visible as it spawns
-            // The system overlaps with another system
-        bool valid = true;
-
-        // Make sure the new system is not initially visible
-        // --> Don't want it to pop in suddenly
-        if (newX >= rocket->getX() - visibleRegion->width() / 2 - MAX_SYSTEM_ORBIT_RADIUS
-                && newX <= rocket->getX() + visibleRegion->width() / 2 + MAX_SYSTEM_ORBIT_RADIUS
-                && newY >= rocket->getY() - visibleRegion->height() / 2 - MAX_SYSTEM_ORBIT_RADIUS
-                && newY <= rocket->getY() + visibleRegion->height() / 2 + MAX_SYSTEM_ORBIT_RADIUS) {
-            valid = false;
+    if (generatedBodies.empty() && emptySectors.empty()) return;
+    // Hand the new systems over to the simulation thread
+    mut.lock();
+    if (resetCount != genResetCount) {
+        // The simulation was reset while we were generating
+        mut.unlock();
+        for (std::vector<Body*>::iterator iter = generatedBodies.begin(), end = generatedBodies.end(); iter != end; ++iter) {
+            delete *iter;
+        }
+        return;
+    }
+    generatedSectors.insert(emptySectors.begin(), emptySectors.end());
+    Body **system = generatedBodies.data();
+    for (size_t i = 0; i < generatedSystemSizes.size(); i++) {
+        int size = generatedSystemSizes[i];
+        // Systems drift, so another system may have moved into this sector
+        // since it was laid out --> Leave this one out for now if they would
+        // overlap. Systems waiting to be added (brought back from the sector
+        // store, or handed over earlier in this loop) aren't indexed yet
+        double x = system[0]->getX() - origin.x(), y = system[0]->getY() - origin.y();
+        if (systemIndex.anyWithin(x, y, sqrt(2) * MAX_SYSTEM_ORBIT_RADIUS) ||
+                pendingSystemWithin(x, y, sqrt(2) * MAX_SYSTEM_ORBIT_RADIUS)) {
+            for (int j = 0; j < size; j++) delete system[j];
         } else {
-            int type;
-            for (std::list<Body*>::iterator iter = bodies.begin(), end = bodies.end(); iter != end; ++iter) {
-                type = (*iter)->getType();
-                // Make sure the new body doesn't overlap with any other system
-                if ((type == Body::Star || type == Body::WhiteDwarf || type == Body::BlackHole)
-                        && (*iter)->getPos()->squareDist(&pos) < pow(MAX_SYSTEM_ORBIT_RADIUS, 2) * 2) {
-                    valid = false;
-                }
+            for (int j = 0; j < size; j++) {
+                // Convert from world coordinates
+                system[j]->translate(-origin.x(), -origin.y());
+                pendingBodies.push_back(system[j]);
             }
+            generatedSectors.insert(generatedSystemSectors[i]);
         }
+        system += size;
+    }
+    mut.unlock();
+}
 
-        if (valid) {
-            // Valid --> Spawn
-            central = new Body(static_cast<Body::BodyType>(2 + rand() % 3));
-            central->setPos(newX, newY);
-            // Velocity between -0.5 and 0.5 in both x and y
-            central->setVel(-0.5 + (rand() % 100) / 100.0,
-                            -0.5 + (rand() % 100) / 100.0);
-            // Spawn the system around the central body
-            spawnPlanetarySystem(central, false);
-        }
+/**
+ * @brief Simulation::generate Runs the procedural generation of planetary
+ * systems on its own low priority thread, so that generating never holds up
+ * a tick or a frame. Generates every GENERATION_INTERVAL ms, or sooner if
+ * requestGeneration() is called.
+ */
+void Simulation::generate() {
+#ifdef __linux__
+    // Lowest priority - generating ahead of the rocket is never urgent
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+#endif
+    while (true) {
+        std::unique_lock<std::mutex> lock(generatorMut);
+        generatorWake.wait_for(lock, std::chrono::milliseconds(GENERATION_INTERVAL),
+                               [this] { return generationRequested; });
+        generationRequested = false;
+        lock.unlock();
+        spawnPlanetarySystem();
     }
 }
 
 /**
- * @brief Simulation::getBodies Returns a copy of list of bodies which are active
- * in the simulation.
- * @return A copy of the list of bodies in the simulation (must be deleted)
+ * @brief Simulation::requestGeneration Wakes the generator thread so that it
+ * looks for new systems to spawn straight away.
  */
-std::list<Body*>* Simulation::getBodies() {
-    std::list<Body*> *bodiesCopy = new std::list<Body*>();
+void Simulation::requestGeneration() {
+    generatorMut.lock();
+    generationRequested = true;
+    generatorMut.unlock();
+    generatorWake.notify_one();
+}
+
+/**
+ * @brief Simulation::getSnapshot Publishes a copy of the bodies which are
+ * active in the simulation, for drawing. The copy is only made once for each
+ * change to the simulation (usually once a tick), and then shared by every
+ * caller until the next change, so any number of views can draw the same
+ * snapshot without copying the bodies again.
+ * @return The latest snapshot. Must not be changed, since others may be
+ * drawing it too
+ */
+std::shared_ptr<Simulation::Snapshot> Simulation::getSnapshot() {
     mut.lock();
-    Body *b;
-    for (std::list<Body*>::iterator iter = bodies.begin(), end = bodies.end(); iter != end; ++iter) {
-        if ((*iter)->getType() == Body::PlayerRocket) {
-            b = static_cast<Rocket*>(*iter)->copy();
-        } else {
-            b = (*iter)->copy();
+    if (snapshot && snapshotVersion == version) {
+        // Nothing has changed since the last snapshot was published
+        std::shared_ptr<Snapshot> latest = snapshot;
+        mut.unlock();
+        return latest;
+    }
+    // Reuse the memory of an old snapshot which only this list still holds.
+    // Snapshots are only handed out here while mut is locked, so nothing can
+    // take hold of one again while it is being refilled
+    std::shared_ptr<Snapshot> next;
+    for (std::vector<std::shared_ptr<Snapshot> >::iterator iter = oldSnapshots.begin(), end = oldSnapshots.end(); iter != end; ++iter) {
+        if (iter->use_count() == 1) {
+            next = *iter;
+            // Make sure the last thread to draw it has finished reading it
+            std::atomic_thread_fence(std::memory_order_acquire);
+            break;
         }
-        bodiesCopy->push_back(b);
     }
+    if (!next) {
+        next = std::make_shared<Snapshot>();
+        if (oldSnapshots.size() < SNAPSHOT_POOL_SIZE) oldSnapshots.push_back(next);
+    }
+    copySnapshot(*next);
+    next->version = version;
+    snapshot = next;
+    snapshotVersion = version;
     mut.unlock();
-    return bodiesCopy;
+    return next;
+}
+
+/**
+ * @brief Simulation::copySnapshot Copies the bodies, their trails and when
+ * they were last moved into the given snapshot, reusing its memory. Trails
+ * are copied whole; each view leaves out the positions too close together
+ * to see at its own zoom when it draws them. Must be called while mut is
+ * locked.
+ * @param copy The snapshot to fill
+ */
+void Simulation::copySnapshot(Snapshot &copy) {
+    copy.bodies.clear();
+    copy.trails.points.clear();
+    copy.trails.lengths.clear();
+    copy.trails.bodies.clear();
+    if (trailsEnabled) {
+        for (std::vector<Body*>::iterator iter = bodies.begin(), end = bodies.end(); iter != end; ++iter) {
+            int trail = (*iter)->getTrail();
+            if (!trails.isOwner(trail, *iter)) continue;
+            int length = trails.getLength(trail);
+            if (length < 2) continue;
+            trails.copyTrail(trail, copy.trails.points);
+            copy.trails.lengths.push_back(length);
+            copy.trails.bodies.push_back(static_cast<int>(iter - bodies.begin()));
+        }
+    }
+    copy.origin = origin;
+    copy.time.tick = tickCount;
+    copy.time.time = lastTickTime;
+    copy.time.interval = lastTickInterval;
+    for (std::vector<Body*>::iterator iter = bodies.begin(), end = bodies.end(); iter != end; ++iter) {
+        copy.bodies.push_back(**iter);
+    }
 }
 
 /**
@@ -307,13 +468,35 @@ std::list<Body*>* Simulation::getBodies() {
 void Simulation::addBody(Body *b) {
     mut.lock();
     bodies.push_back(b);
+    version++;
+    mut.unlock();
+}
+
+/**
+ * @brief Simulation::spawnUniverse Adds many planetary systems at once,
+ * centred on the middle of the visible region. The systems are generated
+ * in parallel on the simulation's own workers, which are only free while it
+ * is locked, so the next tick waits for them.
+ * @param params How many systems to generate and what they are like. Unless
+ * it sets useSeed, the systems come from the simulation's own seed
+ */
+void Simulation::spawnUniverse(const UniverseParams &params) {
+    mut.lock();
+    QPointF centre = QRectF(*visibleRegion).center();
+    if (params.useSeed) {
+        universeGenerator->generate(params, G, centre, bodies);
+    } else {
+        UniverseParams seeded = params;
+        seeded.seed = seed;
+        universeGenerator->generate(seeded, G, centre, bodies);
+    }
+    version++;
     mut.unlock();
 }
 
 /**
- * @brief Simulation::run Runs the simulation by calculating the gravitational forces
- * acting on all bodies, then adjusts their velocity accordingly. Updates the position
- * of all bodies based on their velocity.
+ * @brief Simulation::run Runs the simulation, performing a tick with step()
+ * about 60 times a second while it isn't paused.
  */
 void Simulation::run() {
     // Keep track of how long the current loop has taken
@@ -321,343 +504,393 @@ void Simulation::run() {
     std::chrono::_V2::system_clock::time_point tickStartTime;
     std::chrono::_V2::system_clock::time_point tickEndTime;
     std::chrono::duration<double, std::milli> tickElapsedTime;
-    int loopCount = 0;
 
     while (true) {
-        if (!paused) {
-            tickStartTime = std::chrono::high_resolution_clock::now();
-            if (mode == Exploration) {
-                // No need to spawn every tick, spawn once per 30 ticks
-                if (loopCount % 10 == 0) {
-                    spawnPlanetarySystem();
-
-                    // Update map with area explored
-                    QRectF exploredRegion = *visibleRegion;//calculateValidSpawningRegion();
-                    double x = exploredRegion.x() / MAP_SCALE, y = exploredRegion.y() / MAP_SCALE;
-                    double w = exploredRegion.width() / MAP_SCALE, h = exploredRegion.height() / MAP_SCALE;
-                    // Resize map if necessary
-                    bool resize = false;
-                    QRect rect;
-                    if (x < mapDimensions.x()) {
-                        rect = mapDimensions;
-                        mapDimensions.setX(mapDimensions.x() - 1000);
-                        resize = true;
-                        mapOffset.setX(mapOffset.x() + 1000);
-                    } else if (x + w > mapDimensions.x() + mapDimensions.width()) {
-                        rect = mapDimensions;
-                        mapDimensions.setWidth(mapDimensions.width() + 1000);
-                        resize = true;
-                        mapOffset.setX(mapOffset.x() - 1000);
-                    } else if (y < mapDimensions.y()) {
-                        rect = mapDimensions;
-                        mapDimensions.setY(mapDimensions.y() - 1000);
-                        resize = true;
-                        mapOffset.setY(mapOffset.y() + 1000);
-                    } else if (y + h > mapDimensions.y() + mapDimensions.height()) {
-                        rect = mapDimensions;
-                        mapDimensions.setHeight(mapDimensions.height() + 1000);
-                        resize = true;
-                        mapOffset.setY(mapOffset.y() - 1000);
-                    }
-                    if (resize) {
-                        QImage *newMap = new QImage(mapDimensions.size(), QImage::Format_ARGB32_Premultiplied);
-                        newMap->fill(QColor(255, 255, 255));
-                        QPainter p(newMap);
-                        p.drawImage(rect.topLeft() - mapDimensions.topLeft(), *exploredMap);
-                        QImage *pointer = exploredMap;
-                        exploredMap = newMap;
-                        delete pointer;
-                    }
-                    // Fill out map with area explored
-                    QPainter p(exploredMap);
-                    p.fillRect(static_cast<int>((mapOffset.x() + mapDimensions.x() + mapDimensions.width()) + x),
-                               static_cast<int>((mapOffset.y() + mapDimensions.y() + mapDimensions.height()) + y),
-                               static_cast<int>(w),
-                               static_cast<int>(h),
-                               QColor(0, 0, 255));
-                }
-            }
-
-            // Split the main bodies list into several smaller lists, and have
-            // several threads work in parallel to perform the tick
-            int numThreads = (static_cast<int>(bodies.size()) - 1) / BODIES_PER_THREAD + 1;
-            //std::cout << "numThreads = " << numThreads << std::endl;
-            std::list<std::thread> threads;
-            int numBodies = static_cast<int>(bodies.size());
-
-            // Iterator of start of batch of bodies
-            auto start = bodies.begin();
-            // Don't want anything else editing the bodies list while a tick is in progress
-            mut.lock();
-            for (int i = 0; i < numThreads; i++) {
-                // Create batch of bodies for this thread
-                // Index of the last body in the batch of bodies
-                int endIndex = static_cast<int>(fmin(numBodies, BODIES_PER_THREAD));
-                // Iterator of end of batch of bodies
-                auto end = std::next(start, endIndex);
-                // Create thread and run tick; Add to threads list
-                threads.push_back(std::thread(&Simulation::tick, this, start, std::ref(end)));
-                // Start of next list = end of this list
-                start = end;
-                numBodies -= endIndex;
-            }
-            // Wait for all threads to finish
-            for (auto &t : threads) {
-                t.join();
-            }
-            mut.unlock();
-
-            if (rocket && mode == Exploration && rocket->isActive()) {
-                // W held down? --> Accelerate
-                if (rocket->isFiring()) rocket->accelerate();
-                // A held down? --> Rotate anti-clockwise
-                if (rocket->isRotatingAntiCW()) rocket->rotate(-5);
-                // D held down? --> Rotate clockwise
-                if (rocket->isRotatingCW()) rocket->rotate(5);
-            }
-            for (std::list<Body*>::iterator iter = bodies.begin(), end = bodies.end(); iter != end; ++iter) {
-                // Update position if the body is active
-                if ((*iter)->isActive()) {
-                    (*iter)->move();
-                } else if ((*iter)->getType() != Body::PlayerRocket) {
-                    // Remove body if it isn't active
-                    mut.lock();
-                    delete *iter;
-                    iter = bodies.erase(iter);
-                    mut.unlock();
-                }
-            }
+        {
+            // Paused, or in the background of a hidden window --> Sleep until needed
+            std::unique_lock<std::mutex> idleLock(idleMut);
+            idleWake.wait(idleLock, [this] { return !isIdle(); });
         }
+        tickStartTime = std::chrono::high_resolution_clock::now();
+        step();
         // Sleep to maintain ~60 ticks per second
+        std::this_thread::sleep_until(tickStartTime + std::chrono::milliseconds(16));
         tickEndTime = std::chrono::high_resolution_clock::now();
         tickElapsedTime = tickEndTime - tickStartTime;
-        while(tickElapsedTime.count() < 16) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-            tickEndTime = std::chrono::high_resolution_clock::now();
-            tickElapsedTime = tickEndTime - tickStartTime;
-        }
-        loopCount++;
         //std::cout << "Ticks per second = " << 1000 / tickElapsedTime.count() << std::endl;
         //std::cout << "Size = " << bodies.size() << std::endl;
     }
 }
 
 /**
- * @brief Simulation::tick Performs one tick of processing on the bodies
- * contained in bodiesBatch.
- * @param bodiesBatch The list of bodies to update
+ * @brief Simulation::step Performs a single tick: moves every body on by one
+ * step under gravity and handles collisions. Called by the simulation thread
+ * about 60 times a second, or directly to step a paused simulation as fast
+ * as possible (e.g. when exporting a video).
+ */
+void Simulation::step() {
+    // Don't want anything else editing the bodies list while a tick is in progress
+    mut.lock();
+    if (mode == Exploration) {
+        // No need to update the map every tick, update once per 10 ticks
+        if (tickCount % 10 == 0) {
+            // Update map with area explored
+            QRectF exploredRegion = QRectF(*visibleRegion).translated(origin);
+            exploredMap.fill(QRect(static_cast<int>(floor(exploredRegion.x() / MAP_SCALE)),
+                                   static_cast<int>(floor(exploredRegion.y() / MAP_SCALE)),
+                                   static_cast<int>(ceil(exploredRegion.width() / MAP_SCALE)),
+                                   static_cast<int>(ceil(exploredRegion.height() / MAP_SCALE))));
+            // Redraw the parts of the minimap which have changed
+            minimap->update(exploredMap, exploredRegion.center());
+        }
+    }
+
+    applyPendingBodies();
+    applyPendingSolvers();
+    rebaseOrigin();
+    if (mode == Exploration && rocket && tickCount % EVICTION_INTERVAL == 0) {
+        evictFarSectors();
+    }
+    forceSolver->prepare(bodies);
+    collisionDetector->prepare(bodies, *visibleRegion, scale);
+    // Split the main bodies list into batches of BODIES_PER_THREAD bodies,
+    // and have the worker threads perform the tick on the batches in parallel
+    int numBatches = (static_cast<int>(bodies.size()) + BODIES_PER_THREAD - 1) / BODIES_PER_THREAD;
+    workers->run(numBatches, [this](int batch) { tick(batch); });
+
+    if (rocket && mode == Exploration && rocket->isActive()) {
+        // W held down? --> Accelerate
+        if (rocket->isFiring()) rocket->accelerate();
+        // A held down? --> Rotate anti-clockwise
+        if (rocket->isRotatingAntiCW()) rocket->rotate(-5);
+        // D held down? --> Rotate clockwise
+        if (rocket->isRotatingCW()) rocket->rotate(5);
+    }
+    // Move the active bodies and remove the inactive ones in parallel,
+    // then join the remaining bodies of each batch back together
+    batchSizes.resize(static_cast<size_t>(numBatches));
+    batchDeadBodies.resize(static_cast<size_t>(numBatches));
+    workers->run(numBatches, [this](int batch) { moveBatch(batch); });
+    compactBodies();
+    if (mode == Exploration) {
+        // The index is only used to find systems for the rocket
+        indexSystems();
+    }
+    if (trailsEnabled && tickCount % trailInterval == 0) {
+        recordTrails();
+    }
+    tickCount++;
+    version++;
+    // Remember when the bodies moved, so they can be drawn between ticks
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double interval = std::chrono::duration<double, std::milli>(now - lastTickTime).count();
+    if (interval < MAX_TICK_INTERVAL) {
+        // A longer gap means we were paused, which says nothing about the tick rate
+        lastTickInterval = interval;
+    }
+    lastTickTime = now;
+    mut.unlock();
+}
+
+/**
+ * @brief Simulation::tick Performs one tick of processing on the given batch
+ * of bodies. Collisions are found and handled using the current
+ * CollisionDetector, then gravity is applied using the current ForceSolver.
+ * @param batch Index of the batch of BODIES_PER_THREAD bodies to update
  */
-void Simulation::tick(std::list<Body*>::iterator start, std::list<Body*>::iterator end) {
-    // Create some frequently used variables
-    Vector v;
-    Vector *iter1Pos, *iter2Pos, *iter2PosCopy = &v;
-    int imgWidth, imgHeight;
-    double iter1X, iter1Y, iter1Diam, iter2X, iter2Y, iter2Diam, iter1Mass,
-            iter2Mass, massRatio, sqDist, dist, minX, minY, x1, x2, y1, y2;
-    bool collision = false;
-    QPixmap sprite1, sprite2;
-    QImage spriteImage1, spriteImage2;
+void Simulation::tick(int batch) {
+    // Scratch memory comes from this thread's arena. Anything allocated by the
+    // previous batch this thread handled is no longer needed
+    Arena &arena = Arena::forThread();
+    arena.reset();
+    // Bodies colliding with the current body
+    CollisionList collisions((ArenaAllocator<Body*>(arena)));
+    collisions.reserve(16);
+    size_t start = static_cast<size_t>(batch * BODIES_PER_THREAD);
+    size_t end = start + BODIES_PER_THREAD < bodies.size() ? start + BODIES_PER_THREAD : bodies.size();
+    Body *body;
     // For each body
-    for (std::list<Body*>::iterator iter1 = start, end1 = end; iter1 != end1; ++iter1) {
-        iter1Pos = (*iter1)->getPos();
-        iter1X = iter1Pos->getX();
-        iter1Y = iter1Pos->getY();
-        iter1Diam = (*iter1)->getDiameter();
-        iter1Mass = (*iter1)->getMass();
-        // For each other body
-        for (std::list<Body*>::iterator iter2 = bodies.begin(), end2 = bodies.end(); iter2 != end2; ++iter2) {
-            iter2Pos = (*iter2)->getPos();
-            iter2X = iter2Pos->getX();
-            iter2Y = iter2Pos->getY();
-            // Make sure the two bodies are not the same and that they are both active
-            if (iter1 != iter2 && (*iter1)->isActive() && (*iter2)->isActive()) {
-                // Initialise frequently used variables
-                iter2Diam = (*iter2)->getDiameter();
-
-                // If collision (dist between is less than half the sum of their diameters)
-                //if ((*iter1)->getPos().squareDist((*iter2)->getPos()) <
-                //        pow((*iter1)->getDiameter() / 2, 2) + pow((*iter2)->getDiameter() / 2, 2)) {
-
-                collision = false;
-                // Are the bodies even remotely close to each other?
-                if (fabs(iter1X - iter2X) + fabs(iter1Y - iter2Y) < iter1Diam + iter2Diam) {
-                    // Assuming the two bodies are rectangles, do they overlap?
-                    if (fabs(iter1X - iter2X) < ((iter1Diam + iter2Diam) / 2)
-                            && fabs(iter1Y - iter2Y) < ((iter1Diam + iter2Diam) / 2)) {
-                        // The rectangles overlap --> Is either body on screen?
-                        // Zoomed out too far     --> Accurate collision detection not important, good enough
-                        // Both off screen        --> Good enough
-                        // One or both on screen  --> Further checks
-                        if (scale > 0.3
-                              && ((*iter1)->isWithin(*visibleRegion)
-                              || (*iter2)->isWithin(*visibleRegion))) {
-                            // On screen --> Check if sprites overlap
-
-                            // Get the sprites of the bodies
-                            if ((*iter1)->getType() == Body::PlayerRocket) {
-                                sprite1 = sprites.rocketIdleImage;
-                                sprite2 = sprites.getImage(*iter2);
-                            } else if ((*iter2)->getType() == Body::PlayerRocket) {
-                                sprite1 = sprites.getImage(*iter1);
-                                sprite2 = sprites.rocketIdleImage;
-                            } else {
-                                sprite1 = sprites.getImage(*iter1);
-                                sprite2 = sprites.getImage(*iter2);
-                            }
-                            // Resize the sprites so they're as big as they are on screen
-                            sprite1 = sprite1.scaled(static_cast<int>(iter1Diam * scale),
-                                                     static_cast<int>(iter1Diam * scale));
-                            sprite2 = sprite2.scaled(static_cast<int>(iter2Diam * scale),
-                                                     static_cast<int>(iter2Diam * scale));
-
-                            // Image big enough for just the overlapping parts
-                            // One body's origin will be in one corner, the other in the opposite
-                            imgWidth = static_cast<int>(scale * fabs((iter1X - iter2X)));
-                            if (imgWidth <= 0) imgWidth = 1;
-                            imgHeight = static_cast<int>(scale * fabs((iter1Y - iter2Y)));
-                            if (imgHeight <= 0) imgHeight = 1;
-
-                            // The sprite images are QImages with the cropped and correctly placed sprites,
-                            // with any leftover background set to transparent
-                            // The sprite images are then combined (into spriteImage1) using
-                            // QPainter::CompositionMode_SourceIn to only display overlapping parts of the images
-                            spriteImage1 = QImage(imgWidth, imgHeight, QImage::Format_ARGB32);
-                            spriteImage1.fill(QColor(0,0,0,0));
-                            spriteImage2 = QImage(imgWidth, imgHeight, QImage::Format_ARGB32);
-                            spriteImage2.fill(QColor(0,0,0,0));
-
-                            // Minimums will be the coordinates of the top left of the image
-                            // Taking away the minimums from the bodies' coordinates will produce
-                            // their correct new coordinates for the overlap image
-                            minX = fmin(iter1X, iter2X);
-                            minY = fmin(iter1Y, iter2Y);
-                            // Calculate the coordinates where the images need to be drawn
-                            x1 = scale * (iter1X - minX);
-                            y1 = scale * (iter1Y - minY);
-                            x2 = scale * (iter2X - minX);
-                            y2 = scale * (iter2Y - minY);
-
-                            // Draw sprites into the spriteImages
-                            QPainter p1(&spriteImage1);
-                            // If we are drawing a rocket we need to rotate it to the correct angle
-                            if ((*iter1)->getType() == Body::PlayerRocket) {
-                                // Save state of the painter
-                                p1.save();
-                                // Move the painter to where the rocket is going to be drawn
-                                // (Want the centre of rotation to be the centre of the rocket)
-                                p1.translate(x1, y1);
-                                p1.rotate(rocket->getAngle());
-                                p1.drawImage(static_cast<int>(-scale * (iter1Diam / 2.0)),
-                                             static_cast<int>(-scale * (iter1Diam / 2.0)),
-                                             sprite1.toImage());
-                                // Restore state of the painter
-                                p1.restore();
-                            } else {
-                                p1.drawImage(static_cast<int>(x1 - scale * (iter1Diam / 2.0)),
-                                             static_cast<int>(y1 - scale * (iter1Diam / 2.0)),
-                                             sprite1.toImage());
-                            }
-
-                            QPainter p2(&spriteImage2);
-                            if ((*iter2)->getType() == Body::PlayerRocket) {
-                                p2.save();
-                                p2.translate(x2, y2);
-                                p2.rotate(rocket->getAngle());
-                                p2.drawImage(static_cast<int>(-scale * (iter2Diam / 2.0)),
-                                             static_cast<int>(-scale * (iter2Diam / 2.0)),
-                                             sprite2.toImage());
-                                p2.restore();
-                            } else {
-                                p2.drawImage(static_cast<int>(x2 - scale * (iter2Diam / 2.0)),
-                                             static_cast<int>(y2 - scale * (iter2Diam / 2.0)),
-                                             sprite2.toImage());
-                            }
-                            // Draw the spriteImages on top of each other and find any overlap
-                            p1.setCompositionMode(QPainter::CompositionMode_SourceIn);
-                            p1.drawImage(0, 0, spriteImage2);
-
-                            uchar *line;
-                            collision = false;
-                            QRgb pixel;
-                            // Scan through the image, if any pixels are not ARGB=00000000 then there was
-                            // some overlap --> collision has occurred
-                            for (int i = 0, height = spriteImage1.height(); i < height && !collision; i++) {
-                                // Look at each line
-                                line = (spriteImage1.scanLine(i));
-                                for (int j = 0, width = spriteImage1.width(); j < width; j++) {
-                                    // Look at each pixel in line
-                                    pixel = static_cast<QRgb>(line[static_cast<unsigned int>(j) * sizeof (QRgb)]);
-                                    if (pixel != qRgba(0,0,0,0)) {
-                                        collision = true;
-                                        break;
-                                    }
-                                }
-                            }
-                        } else {
-                            collision = true;
-                        }
-                    }
-                }
-                // We are sure a collision has occurred --> Handle it
-                if (collision) {
-                    // Rocket shouldn't combine, it should explode instead
-                    if (mode == Exploration
-                            && ((*iter1)->getType() == Body::PlayerRocket
-                                || (*iter2)->getType() == Body::PlayerRocket)) {
-                        rocket->setVel(0, 0);
-                        rocket->setActive(false);
-                        rocket->setExploding(true);
-                    } else {
-                        // Combine the two colliding bodies, and mark the smaller body for removal
-                        if ((*iter1)->getMass() >= (*iter2)->getMass()) {
-                            (*iter1)->combine(*iter2);
-                            (*iter2)->setActive(false);
-                        } else {
-                            (*iter2)->combine(*iter1);
-                            (*iter1)->setActive(false);
-                        }
-                    }
-                } else {
-                    // Are the bodies even remotely close to each other?
-                    if (fabs(iter1X - iter2X) + fabs(iter1Y - iter2Y) < 2000) {
-                        // Some optimisations to make sure it's worthwhile to calculate the gravitational forces
-                        // At very large distances the force is negligible
-                        iter2Mass = (*iter2)->getMass();
-                        // If iter1 is a star and iter2 is an asteroid, the force put on iter1 is
-                        // probably negligible and probably not worth calculating, so want the ratio
-                        // to be smaller when iter1 is larger
-                        massRatio = iter2Mass / iter1Mass;
-                        // If iter1 is NOT massively larger than iter2, continue
-                        if (massRatio > 0.001) {
-                            sqDist = iter1Pos->squareDist(iter2Pos);
-//                                    std::cout << "sqDist: " << sqDist << ", iter1Mass: " << iter1Mass << ", iter2Mass: " << iter2Mass
-//                                              << "\nmassRatio: " << massRatio << ", f: " << massRatio / sqDist
-//                                              << "\n\n";
-                            // If the two bodies are relatively close, continue
-                            if (sqDist < 1000000) {
-                                // Calculate gravitational force exerted on body and update velocity
-                                // vel += (G * mass2 * (pos2 - pos 1)) / (dist ^ 3)
-                                // Converted to my Vector notation:
-                                // vel += (pos2 - po1).scale(G * mass2 / (dist ^ 3))
-                                dist = iter2Pos->distance(iter1Pos);
-                                if (dist < 1) dist = 1;
-                                iter2PosCopy->set(iter2Pos);
-                                (*iter1)->setVel( // Set velocity
-                                    (*iter1)->getVel()->add( // Add following to current velocity
-                                        (iter2PosCopy->sub(iter1Pos))->scale( // (pos2 - pos1) scaled by
-                                            G * (*iter2)->getMass() / // G * mass2 divided by
-                                                pow(dist, 3)) // (dist^3)
-                                    )
-                                );
-                            }
-                        }
-                    }
-                }
+    for (size_t i = start; i < end; i++) {
+        body = bodies[i];
+        if (!body->isActive()) continue;
+        // Find and handle any collisions with other bodies
+        collisions.clear();
+        collisionDetector->findCollisions(body, bodies, collisions);
+        for (CollisionList::iterator other = collisions.begin(); other != collisions.end(); ++other) {
+            // Either body may have been consumed by an earlier collision
+            if (body->isActive() && (*other)->isActive()) {
+                handleCollision(body, *other);
             }
         }
+        // Calculate the gravitational forces from all other bodies
+        if (body->isActive()) {
+            forceSolver->applyForces(body, bodies, G);
+        }
     }
 }
 
+/**
+ * @brief Simulation::moveBatch Moves every active body in the given batch
+ * using the current Integrator, and removes the inactive bodies (except the
+ * rocket, which stays to show its explosion). The remaining bodies are
+ * shuffled to the start of the batch, in order, and their number is stored
+ * in batchSizes for compactBodies(). The removed bodies are left in
+ * batchDeadBodies for compactBodies() to delete.
+ * @param batch Index of the batch of BODIES_PER_THREAD bodies to update
+ */
+void Simulation::moveBatch(int batch) {
+    size_t start = static_cast<size_t>(batch * BODIES_PER_THREAD);
+    size_t end = start + BODIES_PER_THREAD < bodies.size() ? start + BODIES_PER_THREAD : bodies.size();
+    // Where the next remaining body should be placed
+    size_t kept = start;
+    std::vector<Body*> &dead = batchDeadBodies[static_cast<size_t>(batch)];
+    dead.clear();
+    for (size_t i = start; i < end; i++) {
+        Body *b = bodies[i];
+        if (b->isActive()) {
+            // Update position if the body is active
+            b->savePos();
+            integrator->integrate(b);
+        } else if (b->getType() != Body::PlayerRocket) {
+            // Remove body if it isn't active
+            dead.push_back(b);
+            continue;
+        }
+        bodies[kept++] = b;
+    }
+    batchSizes[static_cast<size_t>(batch)] = kept - start;
+}
+
+/**
+ * @brief Simulation::compactBodies Closes the gaps left at the end of each
+ * batch by moveBatch(), so that all remaining bodies are together at the
+ * start of the bodies list, then shrinks the list. The bodies every batch
+ * removed are deleted together. Must be called while mut is locked.
+ */
+void Simulation::compactBodies() {
+    deadBodies.clear();
+    for (size_t batch = 0; batch < batchSizes.size(); batch++) {
+        deadBodies.insert(deadBodies.end(), batchDeadBodies[batch].begin(), batchDeadBodies[batch].end());
+    }
+    if (!deadBodies.empty()) {
+        Body::deleteBodies(deadBodies);
+        deadBodies.clear();
+    }
+    size_t size = 0;
+    for (size_t batch = 0; batch < batchSizes.size(); batch++) {
+        std::vector<Body*>::iterator batchStart = bodies.begin() + static_cast<long>(batch * BODIES_PER_THREAD);
+        // Moving backwards through the list, so copying in order is safe
+        std::copy(batchStart, batchStart + static_cast<long>(batchSizes[batch]), bodies.begin() + static_cast<long>(size));
+        size += batchSizes[batch];
+    }
+    bodies.resize(size);
+}
+
+/**
+ * @brief Simulation::handleCollision Handles a collision between two bodies.
+ * The smaller body is combined into the larger body and marked for removal,
+ * unless one of them is the rocket in which case the rocket explodes.
+ * @param b1 The first colliding body
+ * @param b2 The second colliding body
+ */
+void Simulation::handleCollision(Body *b1, Body *b2) {
+    // Rocket shouldn't combine, it should explode instead
+    if (mode == Exploration
+            && (b1->getType() == Body::PlayerRocket
+                || b2->getType() == Body::PlayerRocket)) {
+        rocket->setVel(0, 0);
+        rocket->setActive(false);
+        rocket->setExploding(true);
+    } else {
+        // Combine the two colliding bodies, and mark the smaller body for removal
+        if (b1->getMass() >= b2->getMass()) {
+            b1->combine(b2);
+            b2->setActive(false);
+        } else {
+            b2->combine(b1);
+            b1->setActive(false);
+        }
+    }
+}
+
+/**
+ * @brief Simulation::applyPendingSolvers Swaps in any force solver, collision
+ * detector or integrator requested since the last tick. Must be called from
+ * the simulation thread while mut is locked.
+ */
+void Simulation::applyPendingSolvers() {
+    if (pendingForceSolver) {
+        delete forceSolver;
+        forceSolver = pendingForceSolver;
+        pendingForceSolver = nullptr;
+    }
+    if (pendingCollisionDetector) {
+        delete collisionDetector;
+        collisionDetector = pendingCollisionDetector;
+        pendingCollisionDetector = nullptr;
+    }
+    if (pendingIntegrator) {
+        delete integrator;
+        integrator = pendingIntegrator;
+        pendingIntegrator = nullptr;
+    }
+}
+
+/**
+ * @brief Simulation::applyPendingBodies Adds the systems queued by the
+ * generator thread to the simulation. Must be called from the simulation
+ * thread while mut is locked.
+ */
+void Simulation::applyPendingBodies() {
+    if (pendingBodies.empty()) return;
+    bodies.insert(bodies.end(), pendingBodies.begin(), pendingBodies.end());
+    pendingBodies.clear();
+}
+
+/**
+ * @brief Simulation::rebaseOrigin Moves the origin to the rocket in
+ * Exploration mode, or to the centre of the visible region otherwise, once
+ * it is more than REBASE_DISTANCE away. All positions are shifted to match,
+ * so nothing visibly moves. Must be called while mut is locked.
+ */
+void Simulation::rebaseOrigin() {
+    QPointF focus;
+    if (mode == Exploration && rocket) {
+        focus = QPointF(rocket->getX(), rocket->getY());
+    } else {
+        focus = QRectF(*visibleRegion).center();
+    }
+    if (fabs(focus.x()) < REBASE_DISTANCE && fabs(focus.y()) < REBASE_DISTANCE) return;
+
+    // Snap to whole units so the visible region (stored as a QRect) stays exact
+    double shiftX = floor(focus.x()), shiftY = floor(focus.y());
+    for (std::vector<Body*>::iterator iter = bodies.begin(), end = bodies.end(); iter != end; ++iter) {
+        (*iter)->translate(-shiftX, -shiftY);
+    }
+    trails.translate(-shiftX, -shiftY);
+    visibleRegion->translate(-static_cast<int>(shiftX), -static_cast<int>(shiftY));
+    origin += QPointF(shiftX, shiftY);
+}
+
+/**
+ * @brief Simulation::recordTrails Adds every body's position to the end of
+ * its trail, giving bodies without one a trail if any are free. Trails of
+ * bodies which have gone are freed for reuse. Must be called from the
+ * simulation thread while mut is locked.
+ */
+void Simulation::recordTrails() {
+    for (std::vector<Body*>::iterator iter = bodies.begin(), end = bodies.end(); iter != end; ++iter) {
+        Body *b = *iter;
+        int trail = b->getTrail();
+        if (!trails.isOwner(trail, b)) {
+            trail = trails.allocate(b);
+            b->setTrail(trail);
+            // No trails left --> Try again next time
+            if (trail < 0) continue;
+        }
+        trails.add(trail, b->getX(), b->getY());
+    }
+    trails.reclaim();
+}
+
+/**
+ * @brief Simulation::setTrailsEnabled Sets whether the recent paths of the
+ * bodies should be recorded, to be drawn behind them. The memory for the
+ * trails is allocated the first time they are turned on, and kept.
+ * @param b True to record the trails
+ */
+void Simulation::setTrailsEnabled(bool b) {
+    mut.lock();
+    if (b && trails.getNumTrails() == 0) {
+        trails.resize(MAX_TRAILS, trailLength);
+    } else if (!b) {
+        // Start afresh when turned back on, rather than joining up old paths
+        trails.clear();
+    }
+    trailsEnabled = b;
+    version++;
+    mut.unlock();
+}
+
+/**
+ * @brief Simulation::getTrailsEnabled
+ * @return True if the recent paths of the bodies are being recorded
+ */
+bool Simulation::getTrailsEnabled() {
+    return trailsEnabled;
+}
+
+/**
+ * @brief Simulation::setTrailSettings Sets how much of each body's path is
+ * kept. Existing trails are lost if trails are turned on.
+ * @param length Number of positions kept for each body
+ * @param interval Number of ticks between the positions
+ */
+void Simulation::setTrailSettings(int length, int interval) {
+    mut.lock();
+    trailLength = length > 1 ? length : 2;
+    trailInterval = interval > 0 ? interval : 1;
+    if (trails.getNumTrails() > 0) {
+        trails.resize(MAX_TRAILS, trailLength);
+    }
+    version++;
+    mut.unlock();
+}
+
+/**
+ * @brief Simulation::setSinglePrecision Sets whether gravity should be
+ * calculated in single precision, which is faster with many bodies, or in
+ * double precision using the reference solver.
+ * @param b True to calculate gravity in single precision
+ */
+void Simulation::setSinglePrecision(bool b) {
+    if (b) {
+        setForceSolver(new PackedForceSolver<float>());
+    } else {
+        setForceSolver(new BruteForceSolver());
+    }
+}
+
+/**
+ * @brief Simulation::setForceSolver Sets the algorithm used to calculate the
+ * gravitational forces between bodies. The new solver is used from the next
+ * tick onwards. The simulation takes ownership of the solver.
+ * @param solver The new force solver
+ */
+void Simulation::setForceSolver(ForceSolver *solver) {
+    mut.lock();
+    // Replace any solver which was requested but never used
+    delete pendingForceSolver;
+    pendingForceSolver = solver;
+    mut.unlock();
+}
+
+/**
+ * @brief Simulation::setCollisionDetector Sets the algorithm used to find
+ * colliding bodies. The new detector is used from the next tick onwards.
+ * The simulation takes ownership of the detector.
+ * @param detector The new collision detector
+ */
+void Simulation::setCollisionDetector(CollisionDetector *detector) {
+    mut.lock();
+    delete pendingCollisionDetector;
+    pendingCollisionDetector = detector;
+    mut.unlock();
+}
+
+/**
+ * @brief Simulation::setIntegrator Sets the algorithm used to move bodies
+ * each tick. The new integrator is used from the next tick onwards.
+ * The simulation takes ownership of the integrator.
+ * @param newIntegrator The new integrator
+ */
+void Simulation::setIntegrator(Integrator *newIntegrator) {
+    mut.lock();
+    delete pendingIntegrator;
+    pendingIntegrator = newIntegrator;
+    mut.unlock();
+}
+
 /**
  * @brief Simulation::setG Sets the strength of gravity, G.
  * @param factor newGravity = factor * defaultGravity
@@ -666,6 +899,14 @@ void Simulation::setG(double factor) {
     G = factor * G_DEFAULT;
 }
 
+/**
+ * @brief Simulation::getG
+ * @return The current strength of gravity, G
+ */
+double Simulation::getG() {
+    return G;
+}
+
 /**
  * @brief Simulation::setVisibleRegion Updates the visible region of the player.
  * @param x The x-coordinate of the top left of the visible region
@@ -673,17 +914,26 @@ void Simulation::setG(double factor) {
  * @param newWidth The width of the visible region
  * @param newHeight The height of the visible region
  * @param newScaleThe new scale of the Simulation
+ * @param viewOrigin The origin which x and y are relative to, i.e. the last
+ * origin of the last snapshot the caller was given
  */
-void Simulation::setVisibleRegion(double x, double y, double newWidth, double newHeight, double newScale) {
+void Simulation::setVisibleRegion(double x, double y, double newWidth, double newHeight, double newScale, QPointF viewOrigin) {
+    // The caller may not have seen the latest rebase yet. Held until the
+    // region is set, so a rebase can't slip in between and be lost
+    mut.lock();
+    x += viewOrigin.x() - origin.x();
+    y += viewOrigin.y() - origin.y();
     visibleRegion->setRect(static_cast<int>(x),
                            static_cast<int>(y),
                            static_cast<int>(newWidth),
                            static_cast<int>(newHeight));
     // If we are zooming out, spawn more systems since we can see further now
-    if (mode == Exploration && newScale < scale) {
-        spawnPlanetarySystem();
-    }
+    bool zoomedOut = mode == Exploration && newScale < scale;
     scale = newScale;
+    mut.unlock();
+    if (zoomedOut) {
+        requestGeneration();
+    }
 }
 
 /**
@@ -691,7 +941,53 @@ void Simulation::setVisibleRegion(double x, double y, double newWidth, double ne
  * @param b True if the simulation should be paused
  */
 void Simulation::setPaused(bool b) {
+    idleMut.lock();
     paused = b;
+    idleMut.unlock();
+    idleWake.notify_one();
+}
+
+/**
+ * @brief Simulation::isPaused
+ * @return True if the simulation is paused
+ */
+bool Simulation::isPaused() {
+    idleMut.lock();
+    bool b = paused;
+    idleMut.unlock();
+    return b;
+}
+
+/**
+ * @brief Simulation::setThrottled Sets whether the window showing the
+ * simulation is hidden or minimised. The Background mode simulation is only
+ * there to be looked at, so it stops until the window is shown again.
+ * @param b True if the window is hidden
+ */
+void Simulation::setThrottled(bool b) {
+    idleMut.lock();
+    throttled = b;
+    idleMut.unlock();
+    idleWake.notify_one();
+}
+
+/**
+ * @brief Simulation::isIdle Checks whether the simulation thread should
+ * sleep rather than perform ticks. Must be called while idleMut is locked.
+ * @return True if the simulation is paused, or is running in the background
+ * of a hidden window
+ */
+bool Simulation::isIdle() {
+    return paused || (throttled && mode == Background);
+}
+
+/**
+ * @brief Simulation::getTickCount Returns the number of ticks performed, to
+ * tell whether the bodies have moved. Doesn't wait for the tick in progress.
+ * @return The number of ticks performed
+ */
+long long Simulation::getTickCount() {
+    return tickCount;
 }
 
 /**
@@ -707,17 +1003,55 @@ int Simulation::getMode() {
  * @param newMode The new mode of the simulation
  */
 void Simulation::setMode(Mode newMode) {
+    idleMut.lock();
     mode = newMode;
+    idleMut.unlock();
+    idleWake.notify_one();
 }
 
 /**
- * @brief Simulation::getRocket Returns the rocket being used in the current
+ * @brief Simulation::getRocket Copies the rocket being used in the current
  * simulation. The rocket is only active when the simulation is in
- * Exploration mode.
- * @return
+ * Exploration mode, and there is none while the simulation is being reset.
+ * @param copy Set to a copy of the rocket, if there is one
+ * @return False if there is no rocket
+ */
+bool Simulation::getRocket(Rocket *copy) {
+    mut.lock();
+    bool found = rocket != nullptr;
+    if (found) *copy = *rocket;
+    mut.unlock();
+    return found;
+}
+
+/**
+ * @brief Simulation::setRocketControl Turns one of the rocket's controls on
+ * or off, if there is a rocket.
+ * @param control Which control
+ * @param on True while the player is holding it down
  */
-Rocket* Simulation::getRocket() {
-    return rocket;
+void Simulation::setRocketControl(RocketControl control, bool on) {
+    mut.lock();
+    if (rocket) {
+        if (control == Fire) {
+            rocket->setFiring(on);
+        } else if (control == RotateAntiCW) {
+            rocket->setRotatingAntiCW(on);
+        } else {
+            rocket->setRotatingCW(on);
+        }
+    }
+    mut.unlock();
+}
+
+/**
+ * @brief Simulation::advanceRocketExplosion Moves the rocket's explosion
+ * animation on by a frame, if there is a rocket.
+ */
+void Simulation::advanceRocketExplosion() {
+    mut.lock();
+    if (rocket) rocket->incrementExplodingCount();
+    mut.unlock();
 }
 
 /**
@@ -730,6 +1064,137 @@ void Simulation::setRocket(Rocket *newRocket) {
     rocket = newRocket;
 }
 
+/**
+ * @brief Simulation::calculateStreamingRegion Calculates the region where
+ * sectors are generated or brought back into the simulation. This is the
+ * valid spawning region, moved ahead along the rocket's velocity so that
+ * sectors are ready before the rocket gets there. Must be called while mut
+ * is locked.
+ * @return The streaming region in world coordinates
+ */
+QRectF Simulation::calculateStreamingRegion() {
+    Vector *rocketVel = rocket->getVel();
+    return calculateValidSpawningRegion().translated(
+                rocketVel->getX() * GENERATION_LOOKAHEAD_TICKS + origin.x(),
+                rocketVel->getY() * GENERATION_LOOKAHEAD_TICKS + origin.y());
+}
+
+/**
+ * @brief Simulation::evictFarSectors Moves every body which is well outside
+ * the streaming region into the sector store, grouped by the sector it is
+ * in. The bodies are marked inactive so that they are deleted by this tick's
+ * moveBatch(). They are brought back by the generator thread when their
+ * sector is in the streaming region again. Must be called from the
+ * simulation thread while mut is locked.
+ */
+void Simulation::evictFarSectors() {
+    QRectF region = calculateStreamingRegion();
+    int minX = static_cast<int>(floor(region.left() / SECTOR_SIZE + 0.5)) - EVICTION_MARGIN;
+    int maxX = static_cast<int>(floor(region.right() / SECTOR_SIZE + 0.5)) + EVICTION_MARGIN;
+    int minY = static_cast<int>(floor(region.top() / SECTOR_SIZE + 0.5)) - EVICTION_MARGIN;
+    int maxY = static_cast<int>(floor(region.bottom() / SECTOR_SIZE + 0.5)) + EVICTION_MARGIN;
+    evicting.clear();
+    for (std::vector<Body*>::iterator iter = bodies.begin(), end = bodies.end(); iter != end; ++iter) {
+        Body *b = *iter;
+        if (!b->isActive() || b->getType() == Body::PlayerRocket) continue;
+        int x = static_cast<int>(floor((b->getX() + origin.x()) / SECTOR_SIZE + 0.5));
+        int y = static_cast<int>(floor((b->getY() + origin.y()) / SECTOR_SIZE + 0.5));
+        if (x < minX || x > maxX || y < minY || y > maxY) {
+            evicting.push_back(std::make_pair(sectorId(x, y), b));
+        }
+    }
+    if (evicting.empty()) return;
+    // Store each sector's bodies together
+    std::sort(evicting.begin(), evicting.end());
+    size_t start = 0;
+    while (start < evicting.size()) {
+        size_t end = start;
+        sectorBodies.clear();
+        while (end < evicting.size() && evicting[end].first == evicting[start].first) {
+            sectorBodies.push_back(evicting[end++].second);
+        }
+        if (sectorStore.store(evicting[start].first, sectorBodies.data(), static_cast<int>(sectorBodies.size()),
+                              origin, tickCount)) {
+            for (std::vector<Body*>::iterator iter = sectorBodies.begin(); iter != sectorBodies.end(); ++iter) {
+                (*iter)->setActive(false);
+            }
+        }
+        start = end;
+    }
+}
+
+/**
+ * @brief Simulation::indexSystems Rebuilds the index of system centres
+ * from the bodies' current positions. Must be called while mut is locked.
+ */
+void Simulation::indexSystems() {
+    systemIndex.clear();
+    for (std::vector<Body*>::iterator iter = bodies.begin(), end = bodies.end(); iter != end; ++iter) {
+        if (isSystemCentre(*iter)) {
+            systemIndex.insert((*iter)->getX(), (*iter)->getY());
+        }
+    }
+    systemIndex.build();
+}
+
+/**
+ * @brief Simulation::pendingSystemWithin Checks whether any system waiting to
+ * be added to the simulation has its centre within the given distance of a
+ * point. Must be called while mut is locked.
+ * @param x x-coordinate of the point
+ * @param y y-coordinate of the point
+ * @param radius The distance
+ * @return True if a waiting system is that close
+ */
+bool Simulation::pendingSystemWithin(double x, double y, double radius) {
+    for (std::vector<Body*>::iterator iter = pendingBodies.begin(), end = pendingBodies.end(); iter != end; ++iter) {
+        if (!isSystemCentre(*iter)) continue;
+        double dx = (*iter)->getX() - x, dy = (*iter)->getY() - y;
+        if (dx * dx + dy * dy <= radius * radius) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Simulation::isSystemCentre Checks whether a body can be the centre
+ * of a planetary system.
+ * @param b The body
+ * @return True for stars, white dwarfs and black holes
+ */
+bool Simulation::isSystemCentre(Body *b) {
+    int type = b->getType();
+    return type == Body::Star || type == Body::WhiteDwarf || type == Body::BlackHole;
+}
+
+/**
+ * @brief Simulation::findNearestSystem Finds the centre of the planetary
+ * system nearest to the given point.
+ * @param pos The point to search around, in world coordinates
+ * @param maxDistance Systems further away than this are ignored
+ * @param nearest Set to the centre of the nearest system in world
+ * coordinates, if one was found
+ * @return True if there is a system within maxDistance of pos
+ */
+bool Simulation::findNearestSystem(QPointF pos, double maxDistance, QPointF *nearest) {
+    mut.lock();
+    bool found = systemIndex.findNearest(pos.x() - origin.x(), pos.y() - origin.y(), maxDistance, nearest);
+    if (found) *nearest += origin;
+    mut.unlock();
+    return found;
+}
+
+/**
+ * @brief Simulation::setFastForwardSectors Sets whether systems brought back
+ * from the sector store should be moved on by as far as they would have
+ * drifted while they were stored.
+ * @param b True to fast-forward stored systems
+ */
+void Simulation::setFastForwardSectors(bool b) {
+    mut.lock();
+    fastForwardSectors = b;
+    mut.unlock();
+}
+
 /**
  * @brief Simulation::calculateValidSpawningRegion Calculate valid region where we
  * can spawn planetary systems out of sight of the user. This is equal to the visible
@@ -759,13 +1224,30 @@ QRectF Simulation::calculateValidSpawningRegion() {
 }
 
 /**
- * @brief Simulation::getMap Gets the map representing the area explored
- * by the user-controlled rocket in Exploration mode.
- * @return A QImage representing the area explored by the user-controlled
- * rocket in Exploration mode.
+ * @brief Simulation::getMap Gets an image of the given area of the map
+ * representing the area explored by the user-controlled rocket in
+ * Exploration mode. Each pixel covers MAP_SCALE units.
+ * @param worldRegion The area to draw, in world coordinates
+ * @return A QImage showing the explored area in blue
+ */
+QImage Simulation::getMap(QRectF worldRegion) {
+    QRect cells(static_cast<int>(floor(worldRegion.x() / MAP_SCALE)),
+                static_cast<int>(floor(worldRegion.y() / MAP_SCALE)),
+                static_cast<int>(ceil(worldRegion.width() / MAP_SCALE)),
+                static_cast<int>(ceil(worldRegion.height() / MAP_SCALE)));
+    mut.lock();
+    QImage map = exploredMap.toImage(cells);
+    mut.unlock();
+    return map;
+}
+
+/**
+ * @brief Simulation::getMinimap Gets the minimap of the area explored around
+ * the rocket in Exploration mode, which can be drawn from any thread.
+ * @return The minimap
  */
-QImage* Simulation::getMap() {
-    return exploredMap;
+Minimap* Simulation::getMinimap() {
+    return minimap;
 }
 
 
@@ -1,15 +1,33 @@
 #ifndef SIMULATION_H
 #define SIMULATION_H
 
-#include <list>
+#include <vector>
 #include <mutex>
+#include <chrono>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <unordered_set>
+#include <cstdint>
 #include "body.h"
 #include "rocket.h"
 #include "sprites.h"
+#include "forcesolver.h"
+#include "collisiondetector.h"
+#include "integrator.h"
+#include "workerpool.h"
+#include "exploredmap.h"
+#include "sectorstore.h"
+#include "systemindex.h"
+#include "universegenerator.h"
+#include "trailpool.h"
+#include "minimap.h"
 
 // Gravitational constant - Essentially controls the speed of the simulation
 #define G_DEFAULT 0.005
 // #define G  6.67428E-11
+// How far the player can get from the origin before it is moved to them
+#define REBASE_DISTANCE 10000
 
 /*
  * Runs the actual simulation. Updates the positions and velocities
@@ -24,48 +42,206 @@ public:
         Exploration = 2 // No spawning of bodies, focussed on player-controlled rocket
     };
 
+    // What the player can make the rocket do
+    enum RocketControl {
+        Fire = 0,
+        RotateAntiCW = 1,
+        RotateCW = 2
+    };
+
+    // When the bodies in a snapshot were last moved
+    struct SnapshotTime {
+        long long tick = 0;
+        std::chrono::steady_clock::time_point time;
+        // Milliseconds between the last two ticks
+        double interval = 16;
+    };
+
+    // Copy of everything needed to draw the simulation at one moment.
+    // Published by getSnapshot() and shared by every view of the simulation,
+    // so it must never be changed once published
+    struct Snapshot {
+        // Copies of the bodies. The rocket is copied as a plain Body
+        std::vector<Body> bodies;
+        // Trails of the bodies. Empty if trails are turned off
+        TrailSnapshot trails;
+        // World position of the origin which the bodies' positions are relative to
+        QPointF origin;
+        SnapshotTime time;
+        // Which change to the simulation this is a copy of. Differs between
+        // any two snapshots with different contents
+        long long version = -1;
+    };
+
     Simulation(Sprites sprites);
     ~Simulation();
     void resetSim();
+    void resetSim(uint64_t newSeed);
     void spawnPlanetarySystem(Body* central, bool spawnRocket);
     void spawnPlanetarySystem(double x, double y, double dx, double dy, bool spawnRocket);
     void spawnPlanetarySystem();
-    std::list<Body*>* getBodies();
+    std::shared_ptr<Snapshot> getSnapshot();
     void addBody(Body *b);
+    void spawnUniverse(const UniverseParams &params);
     [[noreturn]] void run(); // Start the simulation
+    void step(); // Perform a single tick
+    [[noreturn]] void generate(); // Start the procedural generation
+    void requestGeneration();
     void setG(double factor);
-    void setVisibleRegion(double x, double y, double newWidth, double newHeight, double newScale);
+    double getG();
+    void setVisibleRegion(double x, double y, double newWidth, double newHeight, double newScale, QPointF viewOrigin);
     void setPaused(bool b);
+    bool isPaused();
+    void setThrottled(bool b);
+    long long getTickCount();
     int getMode();
     void setMode(Mode newMode);
-    Rocket* getRocket();
+    bool getRocket(Rocket *copy);
+    void setRocketControl(RocketControl control, bool on);
+    void advanceRocketExplosion();
     void setRocket(Rocket *newRocket);
     QRectF calculateValidSpawningRegion();
+    void setForceSolver(ForceSolver *solver);
+    void setCollisionDetector(CollisionDetector *detector);
+    void setIntegrator(Integrator *newIntegrator);
+    void setSinglePrecision(bool b);
+    void setFastForwardSectors(bool b);
+    bool findNearestSystem(QPointF pos, double maxDistance, QPointF *nearest);
+    void setTrailsEnabled(bool b);
+    bool getTrailsEnabled();
+    void setTrailSettings(int length, int interval);
 
-    QImage* getMap();
+    QImage getMap(QRectF worldRegion);
+    Minimap* getMinimap();
 
 private:
-    void calculateOrbitVelocity(Body *newBody, Body *central, int maxOrbitDistance);
-    void tick(std::list<Body*>::iterator start, std::list<Body*>::iterator end);
+    void generateSector(uint64_t worldSeed, int sectorX, int sectorY, std::vector<Body*> &newBodies);
+    static uint64_t sectorId(int sectorX, int sectorY);
+    void spawnPlanetarySystem(Body *central, bool spawnRocket, Random &random);
+    void tick(int batch);
+    void moveBatch(int batch);
+    void compactBodies();
+    void handleCollision(Body *b1, Body *b2);
+    void applyPendingSolvers();
+    void applyPendingBodies();
+    void rebaseOrigin();
+    QRectF calculateStreamingRegion();
+    void evictFarSectors();
+    void indexSystems();
+    bool pendingSystemWithin(double x, double y, double radius);
+    static bool isSystemCentre(Body *b);
     void deleteBodies();
+    void recordTrails();
+    void copySnapshot(Snapshot &copy);
+    bool isIdle();
 
     double G = G_DEFAULT;
 
-    std::list<Body*> bodies;
+    std::vector<Body*> bodies;
     std::mutex mut; // Mutex used for locking bodies list
-    bool paused = true; // Should the sim be paused?
+    // Threads which perform each tick in parallel
+    WorkerPool *workers;
+    // Generates the systems for spawnUniverse() on the same workers
+    // (protected by mut)
+    UniverseGenerator *universeGenerator;
+    // Number of bodies left at the start of each batch after moveBatch()
+    // removed the inactive ones. Kept between ticks to reuse its memory
+    std::vector<size_t> batchSizes;
+    // Bodies removed from each batch by moveBatch(), deleted together by
+    // compactBodies() so the body pool is only locked once a tick. Kept
+    // between ticks to reuse their memory
+    std::vector<std::vector<Body*> > batchDeadBodies;
+    std::vector<Body*> deadBodies;
+    bool paused = true; // Should the sim be paused? (protected by idleMut)
+    // Is the window hidden, so the Background mode needn't run? (protected by idleMut)
+    bool throttled = false;
+    // Used to wake the simulation thread when it is unpaused
+    std::mutex idleMut;
+    std::condition_variable idleWake;
     Sprites sprites;
     double scale = 1; // Matches SimulationWidget's scale
     // Area of visible region
     QRect *visibleRegion;
+    // World position of the simulation's (0, 0). Moved to the rocket or the
+    // centre of the screen as they travel, so that positions stay small and
+    // precise however far the player goes (protected by mut)
+    QPointF origin;
+
+    // Algorithms used to perform each tick
+    ForceSolver *forceSolver;
+    CollisionDetector *collisionDetector;
+    Integrator *integrator;
+    // Replacements requested by setForceSolver() etc., swapped in at the
+    // start of the next tick (protected by mut)
+    ForceSolver *pendingForceSolver = nullptr;
+    CollisionDetector *pendingCollisionDetector = nullptr;
+    Integrator *pendingIntegrator = nullptr;
+
+    // Systems made by the generator thread, added to the bodies list at the
+    // start of the next tick (protected by mut)
+    std::vector<Body*> pendingBodies;
+    // Used to wake the generator thread early
+    std::mutex generatorMut;
+    std::condition_variable generatorWake;
+    bool generationRequested = false;
+    // Generator thread's working lists, kept to reuse their memory
+    std::vector<Body*> generatedBodies;
+    std::vector<int> generatedSystemSizes;
+    std::vector<uint64_t> generatedSystemSectors;
+    std::vector<uint64_t> emptySectors;
+    std::vector<QPoint> sectorsToGenerate;
+    // Seed which decides the contents of every sector of the universe
+    uint64_t seed = 0;
+    // Sectors whose system has been added to the simulation, or which have
+    // no system. Sectors are only marked once their system is handed over, so
+    // each is the same however the player got there (protected by mut)
+    std::unordered_set<uint64_t> generatedSectors;
+    // Number of times the bodies have been deleted, so the generator knows
+    // to throw away systems from before a reset (protected by mut)
+    int resetCount = 0;
+    // Bodies of sectors far from the rocket (protected by mut)
+    SectorStore sectorStore;
+    // Should stored systems carry on drifting while stored? (protected by mut)
+    bool fastForwardSectors = true;
+    // Bodies being moved into the sector store, with the sector they are
+    // in. Kept between ticks to reuse its memory
+    std::vector<std::pair<uint64_t, Body*> > evicting;
+    // Bodies of the sector being moved into the sector store. Kept between
+    // ticks to reuse its memory
+    std::vector<Body*> sectorBodies;
+    // Centres of the planetary systems, rebuilt every tick (protected by mut)
+    SystemIndex systemIndex;
+    // Number of ticks performed. Only changed while mut is locked, but can
+    // be read without it
+    std::atomic<long long> tickCount{0};
+    // When the last tick finished, and how long after the one before (protected by mut)
+    std::chrono::steady_clock::time_point lastTickTime;
+    double lastTickInterval = 16;
+
+    // Recent positions of the bodies, for drawing their paths (protected by mut)
+    TrailPool trails;
+    // Only changed while mut is locked, but can be read without it
+    std::atomic<bool> trailsEnabled{false};
+    // Number of positions in each trail, and ticks between them (protected by mut)
+    int trailLength;
+    int trailInterval;
 
     Mode mode = Sandbox;
     Rocket *rocket = nullptr;
 
-    // An image of where the use has explored in Exploration mode
-    QImage *exploredMap = nullptr;
-    QRect mapDimensions;
-    QPoint mapOffset;
+    // Incremented whenever anything copied into a snapshot changes (protected by mut)
+    long long version = 0;
+    // The latest snapshot published, and the version it was copied at (protected by mut)
+    std::shared_ptr<Snapshot> snapshot;
+    long long snapshotVersion = -1;
+    // Snapshots published before, whose memory is reused once nothing is
+    // drawing them any more (protected by mut)
+    std::vector<std::shared_ptr<Snapshot> > oldSnapshots;
+
+    // Where the user has explored in Exploration mode (protected by mut)
+    ExploredMap exploredMap;
+    // Image of the explored map around the rocket, updated along with it
+    Minimap *minimap;
 };
 
 #endif // SIMULATION_H
@@ -1,16 +1,32 @@
-#include <list>
+#include <algorithm>
+#include <chrono>
+#include <vector>
 #include <iostream>
 #include <QtWidgets>
 #include <QMainWindow>
 #include "simulationwidget.h"
 
+// How far away a planetary system can be and still be shown in the panel
+#define NEAREST_SYSTEM_RANGE 20000
+// How many ticks past the latest one bodies may be extrapolated when the
+// simulation is late
+#define MAX_EXTRAPOLATION_TICKS 1
+// Milliseconds between checks for a new frame, and between checks for the
+// window being shown again while it is hidden
+#define FRAME_INTERVAL (1000/60)
+#define HIDDEN_FRAME_INTERVAL 250
+
 /**
  * @brief SimulationWidget::SimulationWidget Creates the simulation
  * widget and begins displaying the bodies in the given Simulation.
  * @param sim The simulation to display in the widget
+ * @param primary True for the main view of the simulation, which resets it
+ * and follows the user's input. False for an extra view, which only shows
+ * the simulation from its own camera
  */
-SimulationWidget::SimulationWidget(Simulation *sim, Sprites sprites) {
+SimulationWidget::SimulationWidget(Simulation *sim, Sprites sprites, bool primary) {
     this->sim = sim;
+    this->primary = primary;
     initialMousePos = new QPointF();
     mousePos = new QPointF();
     currentOffset = new QPointF(0, 0);
@@ -19,14 +35,17 @@ SimulationWidget::SimulationWidget(Simulation *sim, Sprites sprites) {
     totalBackgrounds = new QPointF(0, 0);
 
     this->sprites = sprites;
+    renderer = new Renderer(sprites);
+    // Only the primary view predicts paths --> Other views don't need the thread
+    predictor = primary ? new Predictor() : nullptr;
 
     updateSimVisibleRegion();
-    sim->resetSim();
+    if (primary) sim->resetSim();
 
-    // Start a timer to be used to render at 60 fps
+    // Start a timer to be used to render at 60 fps, when anything has changed
     timer = new QTimer(this);
-    connect(timer, SIGNAL(timeout()), this, SLOT(update()));
-    timer->start(1000/60);
+    connect(timer, SIGNAL(timeout()), this, SLOT(frameTimeout()));
+    timer->start(FRAME_INTERVAL);
 }
 
 /**
@@ -40,6 +59,8 @@ SimulationWidget::~SimulationWidget() {
     delete newOffset;
     delete totalBackgrounds;
     delete timer;
+    delete renderer;
+    delete predictor;
 }
 
 /**
@@ -50,6 +71,7 @@ SimulationWidget::~SimulationWidget() {
  * @param resizeEvent The resize event
  */
 void SimulationWidget::resizeEvent(QResizeEvent *resizeEvent) {
+    viewChanged = true;
     // Update the visible region of the simulation
     updateSimVisibleRegion();
     // Adjust camera so that the centre remains in the middle of the screen
@@ -66,7 +88,8 @@ void SimulationWidget::resizeEvent(QResizeEvent *resizeEvent) {
  * @param event The mouse press event to handle
  */
 void SimulationWidget::mousePressEvent(QMouseEvent *event) {
-    if (event->button() == Qt::LeftButton && sim->getMode() == Simulation::Sandbox) {
+    viewChanged = true;
+    if (event->button() == Qt::LeftButton && sim->getMode() == Simulation::Sandbox && primary) {
         // Left click
         //std::cout << "Left click: " << event->x() << ", " << event->y() << std::endl;
 
@@ -106,6 +129,7 @@ void SimulationWidget::mousePressEvent(QMouseEvent *event) {
  * @param event The mouse release event to handle
  */
 void SimulationWidget::mouseReleaseEvent(QMouseEvent *event) {
+    viewChanged = true;
     if (event->button() == Qt::LeftButton && sim->getMode() == Simulation::Sandbox) {
         // Left click
         if (spawning) {
@@ -145,6 +169,7 @@ void SimulationWidget::mouseReleaseEvent(QMouseEvent *event) {
  * @param event The mouse move event to handle
  */
 void SimulationWidget::mouseMoveEvent(QMouseEvent *event) {
+    viewChanged = true;
     if (spawning) {
         //std::cout << "Mouse move: " << event->x() << ", " << event->y() << std::endl;
         mousePos->setX(event->x() / scale);
@@ -167,6 +192,7 @@ void SimulationWidget::mouseMoveEvent(QMouseEvent *event) {
  * @param event The wheel event to handle
  */
 void SimulationWidget::wheelEvent(QWheelEvent *event) {
+    viewChanged = true;
     //std::cout << "delta: " << event->delta() << std::endl;
     if (sim->getMode() != Simulation::Background) {
         // Calculate size of background images before the resize
@@ -213,16 +239,17 @@ void SimulationWidget::wheelEvent(QWheelEvent *event) {
  * @param event The key press event to handle
  */
 void SimulationWidget::keyPressEvent(QKeyEvent *event) {
+    viewChanged = true;
     //std::cout << "simw Key pressed " << event->key() << std::endl;
     if (event->key() == Qt::Key_W) {
         // W pressed --> Turn rocket engines on
-        sim->getRocket()->setFiring(true);
+        sim->setRocketControl(Simulation::Fire, true);
     } else if (event->key() == Qt::Key_A) {
         // A pressed --> Rotate left
-        sim->getRocket()->setRotatingAntiCW(true);
+        sim->setRocketControl(Simulation::RotateAntiCW, true);
     } else if (event->key() == Qt::Key_D) {
         // D pressed --> Rotate right
-        sim->getRocket()->setRotatingCW(true);
+        sim->setRocketControl(Simulation::RotateCW, true);
     }
 }
 
@@ -232,16 +259,39 @@ void SimulationWidget::keyPressEvent(QKeyEvent *event) {
  * @param event The key release event to handle
  */
 void SimulationWidget::keyReleaseEvent(QKeyEvent *event) {
+    viewChanged = true;
     //std::cout << "simw Key released " << event->key() << std::endl;
     if (event->key() == Qt::Key_W) {
         // W released --> Turn rocket engines on
-        sim->getRocket()->setFiring(false);
+        sim->setRocketControl(Simulation::Fire, false);
     } else if (event->key() == Qt::Key_A) {
         // A released --> Stop rotating left
-        sim->getRocket()->setRotatingAntiCW(false);
+        sim->setRocketControl(Simulation::RotateAntiCW, false);
     } else if (event->key() == Qt::Key_D) {
         // D released --> Stop rotating right
-        sim->getRocket()->setRotatingCW(false);
+        sim->setRocketControl(Simulation::RotateCW, false);
+    }
+}
+
+/**
+ * @brief SimulationWidget::frameTimeout Called 60 times a second. Asks for
+ * the widget to be repainted only if something could look different: the
+ * simulation has ticked, the bodies are still being drawn between ticks, the
+ * user has done something, or the renderer has a frame on the way. While the
+ * window is hidden nothing is painted, and the timer slows down.
+ */
+void SimulationWidget::frameTimeout() {
+    bool nowHidden = !isVisible() || window()->isMinimized();
+    if (nowHidden != hidden) {
+        hidden = nowHidden;
+        if (primary) sim->setThrottled(hidden);
+        timer->setInterval(hidden ? HIDDEN_FRAME_INTERVAL : FRAME_INTERVAL);
+        viewChanged = true;
+    }
+    if (hidden) return;
+    if (viewChanged || spawning || sim->getTickCount() != paintedTick || interpolating ||
+            renderer->isBusy()) {
+        update();
     }
 }
 
@@ -254,42 +304,73 @@ void SimulationWidget::paintEvent(QPaintEvent *) {
     // Update the visible region of the simulation
     updateSimVisibleRegion();
 
-    Rocket *rocket = nullptr;
     // Take a snapshot of the rocket, so position, velocity etc stay
     // constant during the painting
     // Any changes that need to be made (e.g. explosion animation)
     // will be applied to the original rocket
-    Rocket *rocketCopy = nullptr;
+    Rocket rocketCopy;
+    // There is no rocket while the simulation is being reset
+    bool hasRocket = false;
 
     // A reduced version of the current scale to use with the background
     // --> Background isn't affected as much --> Try to give some parallax
     double reducedScale = (scale + 4) / 5;
 
-    std::list<Body*> *bodies = sim->getBodies();
+    // The snapshot is shared with any other views, so the bodies are only
+    // copied once however many views there are
+    std::shared_ptr<Simulation::Snapshot> snapshot = sim->getSnapshot();
+    QPointF bodiesOrigin = snapshot->origin;
+    const Simulation::SnapshotTime &snapshotTime = snapshot->time;
+    // Draw the bodies as far between their previous and current positions
+    // (0 to 1) as we will be between the last tick and the next when the
+    // frame is shown. The renderer's frames are shown by the paint after
+    // the one which requested them, a frame interval later
+    double sinceTick = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - snapshotTime.time).count() + FRAME_INTERVAL;
+    double interpolation = std::max(sinceTick / snapshotTime.interval, 0.0);
+    if (sim->isPaused()) {
+        // Nothing is moving --> Show where the bodies really are
+        interpolation = 1;
+    } else {
+        // The simulation is late --> Hold the bodies where they are rather
+        // than have them jump back when it catches up
+        interpolation = std::min(interpolation, 1.0 + MAX_EXTRAPOLATION_TICKS);
+    }
+    paintedTick = snapshotTime.tick;
+    // Paused or held at the limit --> The bodies stay put until the next tick
+    interpolating = !sim->isPaused() && interpolation < 1.0 + MAX_EXTRAPOLATION_TICKS;
+    bool userChanged = viewChanged;
+    viewChanged = false;
+    if (bodiesOrigin != viewOrigin) {
+        // The simulation has moved its origin --> Move the camera (and the
+        // body being spawned) by the same amount so nothing appears to move
+        QPointF shift = bodiesOrigin - viewOrigin;
+        *currentOffset -= shift;
+        if (spawning) {
+            newBody->setPos(newBody->getX() - shift.x(), newBody->getY() - shift.y());
+        }
+        viewOrigin = bodiesOrigin;
+    }
     if (sim->getMode() == Simulation::Exploration) {
-        rocket = sim->getRocket();
-        rocketCopy = rocket->copy();
-        // Adjust camera so that the rocket is in the centre of the screen
-        currentOffset->setX((-width() / 2.0 / scale) + rocketCopy->getX());
-        currentOffset->setY((-height() / 2.0 / scale) + rocketCopy->getY());
+        hasRocket = sim->getRocket(&rocketCopy);
+    }
+    if (hasRocket) {
+        // Adjust camera so that the rocket (where it is drawn) is in the centre of the screen
+        double rocketX = rocketCopy.getPrevX() + (rocketCopy.getX() - rocketCopy.getPrevX()) * interpolation;
+        double rocketY = rocketCopy.getPrevY() + (rocketCopy.getY() - rocketCopy.getPrevY()) * interpolation;
+        currentOffset->setX((-width() / 2.0 / scale) + rocketX);
+        currentOffset->setY((-height() / 2.0 / scale) + rocketY);
         // Adjust background position based on the movement of the rocket
         // Want to increase scale at low numbers, decrease at high numbers
         // to give a solid parallax effect
         double scaleFactor = (scale * 20 + 1) / (scale + 50);
-        *backgroundOffset += QPointF(rocketCopy->getVelX() * scaleFactor,
-                                     rocketCopy->getVelY() * scaleFactor);
+        *backgroundOffset += QPointF(rocketCopy.getVelX() * scaleFactor,
+                                     rocketCopy.getVelY() * scaleFactor);
     }
 
-    // Draw black background
-    p.fillRect(0, 0, width(), height(), QColor(0, 0, 0));
-    // Draw background image, looped and to the correct scale
     // Adjust size of the background image
     double backgroundWidth = sprites.backgroundImage.width() * reducedScale;
     double backgroundHeight = sprites.backgroundImage.height() * reducedScale;
-    // Calculate number of background images needed to cover the screen
-    int numBackgroundsX = static_cast<int>((width()) / backgroundWidth) + 3;
-    int numBackgroundsY = static_cast<int>((height()) / backgroundHeight) + 3;
-
     double backgroundX, backgroundY;
     if (scale > 1) {
         // Zoomed in --> BG less affected by camera movement
@@ -300,139 +381,149 @@ void SimulationWidget::paintEvent(QPaintEvent *) {
             backgroundX = (-newOffset->x() * 0.9 * scale - backgroundOffset->x()) + width() / 2.0;
             backgroundY = (-newOffset->y() * 0.9 * scale - backgroundOffset->y()) + height() / 2.0;
     }
-    // Calculate coordinates of first (top left) background to be drawn
-    double firstX = fmod(backgroundX, backgroundWidth);
-    double firstY = fmod(backgroundY, backgroundHeight);
-    // Draw all background images
-    for (int i = 0; i < numBackgroundsX; i++) {
-        for (int j = 0; j < numBackgroundsY; j++) {
-            p.drawPixmap(static_cast<int>(firstX) + (i - 1) * static_cast<int>(backgroundWidth),
-                         static_cast<int>(firstY) + (j - 1) * static_cast<int>(backgroundHeight),
-                         static_cast<int>(backgroundWidth),
-                         static_cast<int>(backgroundHeight),
-                         sprites.backgroundImage);
+
+    // Predict where the rocket, or the body being spawned, will go. Done
+    // before the snapshot is handed to the renderer
+    bool predicting = false;
+    if (!predictor) {
+        // Not the primary view --> Nothing to predict
+    } else if (hasRocket && rocketCopy.isActive() && !rocketCopy.isExploding()) {
+        predictor->requestPrediction(rocketCopy, snapshot->bodies, rocketCopy.isFiring(), snapshotTime.tick,
+                                     bodiesOrigin, sim->getG());
+        predicting = true;
+    } else if (spawning) {
+        // The velocity the body would be given if released now
+        Body preview = *newBody;
+        preview.setVel(0.05 * (newBody->getX() - mousePos->x() - currentOffset->x()),
+                       0.05 * (newBody->getY() - mousePos->y() - currentOffset->y()));
+        predictor->requestPrediction(preview, snapshot->bodies, false, snapshotTime.tick, bodiesOrigin, sim->getG());
+        predicting = true;
+    } else {
+        predictor->clear();
+    }
+
+    // Ask the renderer to draw this snapshot
+    Renderer::View view;
+    view.width = width();
+    view.height = height();
+    view.scale = scale;
+    view.left = newOffset->x() + currentOffset->x();
+    view.top = newOffset->y() + currentOffset->y();
+    view.backgroundX = fmod(backgroundX, backgroundWidth);
+    view.backgroundY = fmod(backgroundY, backgroundHeight);
+    view.backgroundScale = reducedScale;
+    view.interpolation = interpolation;
+    view.drawRocket = hasRocket;
+    // Only ask for a new frame if it would differ from the last one asked for.
+    // Otherwise the renderer would stay busy, and the view would never go idle
+    // The rocket's controls and explosion change how it is drawn between ticks
+    int explodingCount = hasRocket && rocketCopy.isExploding() ? rocketCopy.getExplodingCount() : -1;
+    bool firing = hasRocket && rocketCopy.isFiring();
+    if (userChanged || snapshot->version != requestedVersion || !(view == requestedView) ||
+            explodingCount != requestedExplodingCount || firing != requestedFiring) {
+        renderer->requestFrame(snapshot, rocketCopy, view);
+        requestedVersion = snapshot->version;
+        requestedView = view;
+        requestedExplodingCount = explodingCount;
+        requestedFiring = firing;
+    }
+
+    // Draw the last frame the renderer finished
+    renderer->takeFrame(frame);
+    if (frame.isNull()) {
+        // Nothing rendered yet
+        p.fillRect(0, 0, width(), height(), QColor(0, 0, 0));
+    } else {
+        p.drawImage(0, 0, frame);
+    }
+
+    // Draw the predicted path
+    if (predicting) {
+        predictor->getPath(predictedPath);
+        QPointF topLeft = viewOrigin + *newOffset + *currentOffset;
+        for (std::vector<QPointF>::iterator iter = predictedPath.begin(), end = predictedPath.end(); iter != end; ++iter) {
+            *iter = (*iter - topLeft) * scale;
+        }
+        if (predictedPath.size() > 1) {
+            p.setPen(QColor(255, 255, 255, 100));
+            p.drawPolyline(predictedPath.data(), static_cast<int>(predictedPath.size()));
         }
     }
 
-    for (std::list<Body*>::iterator iter = bodies->begin(), end = bodies->end(); iter != end; ++iter) {
-        double bodyDiam = (*iter)->getDiameter();
-        if ((*iter)->getType() == Body::PlayerRocket && sim->getMode() == Simulation::Exploration) {
-            // If drawing the player controlled rocket
-            // Save state of the painter so we can undo translations and rotations
-            p.save();
-            // Move the painter to the coordinates of the rocket
-            // (We want the centre of any rotation to be the centre of the rocket)
-            p.translate(scale * rocketCopy->getX() -
-                            ((newOffset->x() + currentOffset->x()) * scale),
-                        scale * rocketCopy->getY() -
-                            ((newOffset->y() + currentOffset->y()) * scale));
-
-            if (rocketCopy->isExploding()) {
-                // If the the rocket has collided with another body and is now exploding
-                if (rocketCopy->getExplodingCount() < 64) {
-                    // Draw the explosion animation (slowed down 4x)
-                    p.drawPixmap(static_cast<int>(-bodyDiam * scale),
-                                 static_cast<int>(-bodyDiam * scale),
-                                 sprites.getSpriteSheetImage(sprites.rocketExplosionSpriteSheet,
-                                                             4, 4, rocketCopy->getExplodingCount() / 4,
-                                                             static_cast<int>(2 * bodyDiam * scale),
-                                                             static_cast<int>(2 * bodyDiam * scale)));
-                    // Advance to next frame
-                    rocket->incrementExplodingCount();
-                } else {
-                    // Explosion animation has finished, don't draw anything
-                    // GAME OVER
-                    if (!gameOver) {
-                        // Send out a signal that a game over state has occurred
-                        gameOverSignal();
-                        gameOver = true;
-                    }
-                }
-            } else {
-                // Draw rocket normally
-                // Rotate the painter so we can draw the rocket at the correct angle
-                p.rotate(rocketCopy->getAngle());
-                // Choose the correct sprite based on whether or not the rocket is firing
-                QPixmap s;
-                if (rocketCopy->isFiring()) {
-                    s = sprites.rocketFiringImage;
-                } else {
-                    s = sprites.rocketIdleImage;
-                }
-                // Resize sprite
-                s = s.scaled(static_cast<int>(rocketCopy->getDiameter() * scale),
-                             static_cast<int>(rocketCopy->getDiameter() * scale));
-                // Draw sprite
-                p.drawPixmap(static_cast<int>((-bodyDiam / 2.0) * scale),
-                             static_cast<int>((-bodyDiam / 2.0) * scale),
-                             s);
-            }
-            // Restore the previous state of the painter
-            p.restore();
+    if (!primary) {
+        // Outline the view so it stands out from the one behind it
+        p.setPen(QColor(200, 200, 200));
+        p.drawRect(0, 0, width() - 1, height() - 1);
+        return;
+    }
+
+    if (hasRocket && rocketCopy.isExploding()) {
+        // The rocket has collided with another body and is now exploding
+        if (rocketCopy.getExplodingCount() < sprites.getAnimationLength(Sprites::RocketExplosionAnimation) * 4) {
+            // Advance to next frame (the animation is slowed down 4x)
+            sim->advanceRocketExplosion();
         } else {
-            // Drawing any other body
-            p.drawPixmap(static_cast<int>(scale * ((*iter)->getX() - (bodyDiam / 2.0)) -
-                                           ((newOffset->x() + currentOffset->x()) * scale)),
-                         static_cast<int>(scale * ((*iter)->getY() - (bodyDiam / 2.0)) -
-                                           ((newOffset->y() + currentOffset->y()) * scale)),
-                         static_cast<int>((*iter)->getDiameter() * scale),
-                         static_cast<int>((*iter)->getDiameter() * scale),
-                         sprites.getImage(*iter));
+            // Explosion animation has finished
+            // GAME OVER
+            if (!gameOver) {
+                // Send out a signal that a game over state has occurred
+                gameOverSignal();
+                gameOver = true;
+            }
         }
     }
 
     // Draw rocket angle, direction and speed
-    if (sim->getMode() == Simulation::Exploration) {
+    if (hasRocket) {
         QPoint panelSize(100, 100); // Size of the panel
         QPoint rocketSize(panelSize.x() - 10, panelSize.y() - 10); // Size of rocket
         QPoint coords(5, height() - panelSize.y() - 5); // Top left coords of the panel
         // Draw grey background
         p.fillRect(coords.x(), coords.y(), panelSize.x(), panelSize.y(), QColor(50, 50, 50));
         // Draw rocket speed
-        QString speedText = QString::number(rocketCopy->getVel()->getNormal(), 'g', 4);
+        QString speedText = QString::number(rocketCopy.getVel()->getNormal(), 'g', 4);
         p.drawText(coords, QString("Speed: ") + speedText);
+        // Draw distance to the nearest planetary system
+        QPointF rocketPos = QPointF(rocketCopy.getX(), rocketCopy.getY()) + viewOrigin;
+        QPointF nearest;
+        QString nearestText("None in range");
+        if (sim->findNearestSystem(rocketPos, NEAREST_SYSTEM_RANGE, &nearest)) {
+            QPointF diff = nearest - rocketPos;
+            nearestText = QString::number(sqrt(diff.x() * diff.x() + diff.y() * diff.y()), 'f', 0);
+        }
+        p.drawText(coords - QPoint(0, 15), QString("Nearest system: ") + nearestText);
         // Save painter state
         p.save();
         // Position painter at the centre of the panel location
         p.translate(coords.x() + panelSize.x() / 2, coords.y() + panelSize.y() / 2);
         // Rotate painter to rocket's angle
-        p.rotate(rocketCopy->getAngle());
+        p.rotate(rocketCopy.getAngle());
         // Get correct sprite
-        QPixmap s;
-        if (rocketCopy->isFiring()) {
-            s = sprites.rocketFiringImage;
-        } else {
-            s = sprites.rocketIdleImage;
-        }
-        // Resize sprite
-        s = s.scaled(rocketSize.x(), rocketSize.y());
+        const QPixmap &s = rocketCopy.isFiring() ? sprites.rocketFiringImage : sprites.rocketIdleImage;
         // Draw sprite
-        p.drawPixmap(-rocketSize / 2, s);
+        p.drawPixmap(-rocketSize.x() / 2, -rocketSize.y() / 2, rocketSize.x(), rocketSize.y(),
+                     sprites.getMip(s, Sprites::getMipLevel(s.size(), rocketSize.x())));
         // Restore painter state
         p.restore();
         // Draw velocity direction arrow (similarly to rocket)
-        if (rocket->isActive()) {
-            double angle = atan(rocketCopy->getVelY() / rocketCopy->getVelX()) * (180.0 / M_PI);
-            if (rocketCopy->getVelX() < 0) angle += 180;
+        if (rocketCopy.isActive()) {
+            double angle = atan(rocketCopy.getVelY() / rocketCopy.getVelX()) * (180.0 / M_PI);
+            if (rocketCopy.getVelX() < 0) angle += 180;
             p.save();
             p.translate(coords.x() + panelSize.x() / 2, coords.y() + panelSize.y() / 2);
             p.rotate(angle);
-            s = sprites.arrowIcon.scaled(rocketSize.x(), rocketSize.y());
-            p.drawPixmap(-rocketSize / 2, s);
+            p.drawPixmap(-rocketSize.x() / 2, -rocketSize.y() / 2, rocketSize.x(), rocketSize.y(),
+                         sprites.getMip(sprites.arrowIcon, Sprites::getMipLevel(sprites.arrowIcon.size(), rocketSize.x())));
             p.restore();
         }
     }
 
-    // Delete copy of bodies list
-    for (std::list<Body*>::iterator iter = bodies->begin(), end = bodies->end(); iter != end; ++iter) {
-        delete *iter;
-    }
-    delete bodies;
-    delete rocketCopy;
-
     // Draw the map showing where the rocket has explored
-//    QImage *map = sim->getMap();
-//    p.drawImage(QRect(0, height() - 250, 250, 250), *map);
+    if (hasRocket) {
+        int mapSize = Minimap::getSize();
+        sim->getMinimap()->draw(p, QPoint(width() - mapSize - 5, height() - mapSize - 5),
+                                QPointF(rocketCopy.getX(), rocketCopy.getY()) + viewOrigin);
+    }
 
     // If we are spawning a new body (left click is down), draw it and
     // an arrow to show its direction and give an indication of its velocity
@@ -444,11 +535,12 @@ void SimulationWidget::paintEvent(QPaintEvent *) {
 
         int bodyDiam = static_cast<int>(scale * newBody->getDiameter());
         // Draw the body being spawned
+        const QPixmap &newSprite = sprites.getSprite(sprites.getSpriteId(newBody));
         p.drawPixmap(static_cast<int>(bodyX - (bodyDiam / 2.0)),
                      static_cast<int>(bodyY - (bodyDiam / 2.0)),
                      static_cast<int>(newBody->getDiameter() * scale),
                      static_cast<int>(newBody->getDiameter() * scale),
-                     sprites.getImage(newBody));
+                     sprites.getMip(newSprite, Sprites::getMipLevel(newSprite.size(), bodyDiam)));
 
         p.setPen(QColor(255, 255, 255));
         // Line from mouse to new asteroid
@@ -485,16 +577,43 @@ void SimulationWidget::setSpawnType(Body::BodyType type) {
     spawnType = type;
 }
 
+/**
+ * @brief SimulationWidget::setHeatmapSettings Sets when the bodies are drawn
+ * as a heatmap of their density rather than one by one, for scenes with too
+ * many bodies to tell apart.
+ * @param threshold Number of bodies on screen above which the heatmap is drawn
+ * @param byMass True to show the density of mass, rather than of bodies
+ */
+void SimulationWidget::setHeatmapSettings(int threshold, bool byMass) {
+    renderer->setHeatmapSettings(threshold, byMass);
+    viewChanged = true;
+}
+
+/**
+ * @brief SimulationWidget::setZoom Sets how far the view is zoomed in,
+ * keeping the centre of the view where it is.
+ * @param newScale Pixels per unit of distance in the simulation
+ */
+void SimulationWidget::setZoom(double newScale) {
+    *currentOffset += QPointF(width() / 2.0 / scale - width() / 2.0 / newScale,
+                              height() / 2.0 / scale - height() / 2.0 / newScale);
+    scale = newScale;
+    viewChanged = true;
+    updateSimVisibleRegion();
+}
+
 /**
  * @brief SimulationWidget::updateSimVisibleRegion Updates the
- * visible region of the Simulation.
+ * visible region of the Simulation, if this is its main view.
  */
 void SimulationWidget::updateSimVisibleRegion() {
+    if (!primary) return;
     sim->setVisibleRegion(currentOffset->x() + newOffset->x(),
                           currentOffset->y() + newOffset->y(),
                           width() / scale,
                           height() / scale,
-                          scale);
+                          scale,
+                          viewOrigin);
 }
 
 
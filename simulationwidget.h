@@ -3,17 +3,24 @@
 
 #include <QtWidgets>
 #include "simulation.h"
+#include "renderer.h"
+#include "predictor.h"
 
 class SimulationWidget : public QWidget {
     Q_OBJECT
 public:
-    SimulationWidget(Simulation *sim, Sprites sprites);
+    SimulationWidget(Simulation *sim, Sprites sprites, bool primary = true);
     ~SimulationWidget() override;
     void setSpawnType(Body::BodyType type);
+    void setHeatmapSettings(int threshold, bool byMass);
+    void setZoom(double newScale);
 
 signals:
     void gameOverSignal();
 
+private slots:
+    void frameTimeout();
+
 protected:
     void resizeEvent(QResizeEvent *event) override;
     void mousePressEvent(QMouseEvent *event) override;
@@ -27,7 +34,34 @@ protected:
 private:
     QTimer *timer;
     Simulation *sim;
+    // Is this the main view of the simulation? The main view decides which
+    // part of the simulation is active, takes the user's input and draws the
+    // HUD. Other views (e.g. an inset) only draw the bodies with their own camera
+    bool primary;
     Sprites sprites;
+    // Draws the bodies and background on its own thread
+    Renderer *renderer;
+    // The last frame the renderer finished
+    QImage frame;
+    // Predicts where the rocket, or the body being spawned, will go. Null
+    // unless this is the primary view
+    Predictor *predictor;
+    // The last path the predictor published, in world coordinates
+    std::vector<QPointF> predictedPath;
+    // What the last frame showed, to tell whether another is needed
+    long long paintedTick = -1;
+    // Were the bodies drawn part way between ticks, so they will have moved by the next frame?
+    bool interpolating = false;
+    // What the last frame was requested for, so the renderer is only asked
+    // for a new one when it would look different
+    long long requestedVersion = -1;
+    Renderer::View requestedView;
+    int requestedExplodingCount = -1;
+    bool requestedFiring = false;
+    // Has the camera moved, or the user done something, since the last frame?
+    bool viewChanged = true;
+    // Is the window hidden or minimised?
+    bool hidden = false;
     Body *newBody;
     bool spawning = false;
     Body::BodyType spawnType = Body::Asteroid; // Initially asteroid
@@ -43,6 +77,9 @@ private:
     QPointF *newOffset;
     // How many background images we would have to travel back over to get to the origin
     QPointF *totalBackgrounds;
+    // The simulation's origin when we last drew it. All of our coordinates
+    // are relative to this
+    QPointF viewOrigin;
     bool movingCamera = false;
 
     // Triggered when the player dies and the explosion animation finished in exploration mode
@@ -1,6 +1,12 @@
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include "sprites.h"
 
+// Most memory in bytes the scaled sprites may use before the least recently
+// used are dropped
+#define SPRITE_CACHE_MEMORY (16 * 1024 * 1024)
+
 Sprites::Sprites() {
     // Load all images
     char invalidPath[] = "/sprites/invalid.png";
@@ -47,9 +53,14 @@ Sprites::Sprites() {
 
     char rocketExplosionPath[] = "/sprites/rocketexplosion.png";
     rocketExplosionSpriteSheet = loadImage(rocketExplosionPath);
+    animations[RocketExplosionAnimation] = sliceSpriteSheet(rocketExplosionSpriteSheet, 4, 4);
 
     char arrowPath[] = "/icons/arrow.png";
     arrowIcon = loadImage(arrowPath);
+
+    for (int i = 0; i < NumSprites; i++) {
+        averageColors[i] = calculateAverageColor(getSprite(static_cast<SpriteId>(i)));
+    }
 }
 
 /**
@@ -67,116 +78,345 @@ QPixmap Sprites::loadImage(char path[]) {
 }
 
 /**
- * @brief Sprites::getImage
- * @param b
- * @return
+ * @brief Sprites::getImage Returns the image to draw the given body with.
+ * @param b The body to be drawn
+ * @return The body's image
  */
 QPixmap Sprites::getImage(Body* b) {
+    return getSprite(getSpriteId(b));
+}
+
+/**
+ * @brief Sprites::getSpriteId Returns which sprite the given body should be
+ * drawn with, so that bodies with the same sprite can be drawn together.
+ * @param b The body to be drawn
+ * @return The body's sprite
+ */
+Sprites::SpriteId Sprites::getSpriteId(Body *b) {
     Rocket *r;
     switch (b->getType()) {
     case Body::Asteroid:
-        return asteroidImage;
+        return AsteroidSprite;
     case Body::Planet:
-        return getPlanetImage(b->getPlanetType());
+        // Planet types 1 to 5 have their own sprites
+        if (b->getPlanetType() >= 1 && b->getPlanetType() <= 5) {
+            return static_cast<SpriteId>(Planet1Sprite + b->getPlanetType() - 1);
+        }
+        return Planet1Sprite;
     case Body::Star:
-        return starImage;
+        return StarSprite;
     case Body::WhiteDwarf:
-        return whitedwarfImage;
+        return WhiteDwarfSprite;
     case Body::BlackHole:
-        return blackholeImage;
+        return BlackHoleSprite;
     case Body::PlayerRocket:
         r = static_cast<Rocket*>(b);
         if (r->isFiring()) {
-            return rocketFiringImage;
+            return RocketFiringSprite;
         } else {
-            return rocketIdleImage;
+            return RocketIdleSprite;
         }
     default:
-        return invalidImage;
+        return InvalidSprite;
     }
 }
 
 /**
- * @brief Sprites::getPlanetImage Returns the planet image corresponding to
- * the given planet type.
- * @param t The planet type
- * @return The planet image corresponding to the given planet type
+ * @brief Sprites::getSprite Returns the image for the given sprite, without
+ * copying it.
+ * @param id The sprite
+ * @return The sprite's image
  */
-QPixmap Sprites::getPlanetImage(int t) {
-    switch (t) {
-        case 1:
-            return planet1Image;
-        case 2:
-            return planet2Image;
-        case 3:
-            return planet3Image;
-        case 4:
-            return planet4Image;
-        case 5:
-            return planet5Image;
-        default:
-            return planet1Image;
+const QPixmap& Sprites::getSprite(SpriteId id) {
+    switch (id) {
+    case AsteroidSprite:
+        return asteroidImage;
+    case Planet1Sprite:
+        return planet1Image;
+    case Planet2Sprite:
+        return planet2Image;
+    case Planet3Sprite:
+        return planet3Image;
+    case Planet4Sprite:
+        return planet4Image;
+    case Planet5Sprite:
+        return planet5Image;
+    case StarSprite:
+        return starImage;
+    case WhiteDwarfSprite:
+        return whitedwarfImage;
+    case BlackHoleSprite:
+        return blackholeImage;
+    case RocketIdleSprite:
+        return rocketIdleImage;
+    case RocketFiringSprite:
+        return rocketFiringImage;
+    default:
+        return invalidImage;
     }
 }
 
 /**
- * @brief Sprites::getSpriteSheetImage Returns the n'th sprite in the sprite
- * sheet spriteSheet, where there are width number of images in each row of
- * the sprite sheet, and height number of images in each column.
- * @param width The number of images in each row of the sprite sheet
- * @param height The number of images in each column of the sprite sheet
- * @param n The number of the sprite in the sprite sheet, counting from top
- * left to bottom right
- * @param spriteWidth Width in pixels of the sprite to be drawn
- * @param spriteHeight Height in pixels of the sprite to be drawn
- * @return The cropped sprite sheet containing just the image requested
- */
-QPixmap Sprites::getSpriteSheetImage(QPixmap spriteSheet, int width, int height, int n, int spriteWidth, int spriteHeight) {
-    // Find row and column of where the requested sprite is located within the sprite sheet
-    // Top left = (0, 0)
-    int row = n / width;
-    int col = n % width;
-
-    int sheetWidth = spriteSheet.width();
-    int sheetHeight = spriteSheet.height();
-    // Width in pixels for each sprite = number of pixels per row / number of sprites per row
-    int widthPerSprite = sheetWidth / width;
-    int heightPerSprite = sheetHeight / height;
-
-    QPixmap sprite(widthPerSprite, heightPerSprite);
-    // Wipe the sprite clean and fill it with transparent pixels
-    sprite.fill(QColor(0,0,0,0));
-    QPainter p(&sprite);
-    // Draw the sprite in the sprite sheet onto its own QPixmap
-    p.drawPixmap(0, 0,                                          // Origin of target (sprite)
-                 widthPerSprite, heightPerSprite,               // Width/height of target (sprite)
-                 spriteSheet,                                   // Source to copy from (spriteSheet)
-                 col * widthPerSprite, row * heightPerSprite,   // Origin of area to copy from (spriteSheet)
-                 widthPerSprite, heightPerSprite);              // Width of area to copy from (spriteSheet)
-    // Scale the image to the correct dimensions
-    return sprite.scaled(spriteWidth, spriteHeight);
+ * @brief Sprites::getAverageColor Returns the average colour of the given
+ * sprite, used to draw bodies that are too small on screen for their sprite.
+ * @param id The sprite
+ * @return The sprite's average colour, fully opaque
+ */
+QRgb Sprites::getAverageColor(SpriteId id) {
+    return averageColors[id];
 }
 
+/**
+ * @brief Sprites::calculateAverageColor Averages the colour of every pixel
+ * of the sprite, weighting each by how opaque it is so that transparent
+ * pixels around the body don't count.
+ * @param sprite The sprite
+ * @return The sprite's average colour, fully opaque
+ */
+QRgb Sprites::calculateAverageColor(const QPixmap &sprite) {
+    QImage img = sprite.toImage();
+    double red = 0, green = 0, blue = 0, alpha = 0;
+    for (int y = 0; y < img.height(); y++) {
+        for (int x = 0; x < img.width(); x++) {
+            QRgb pixel = img.pixel(x, y);
+            red += qRed(pixel) * qAlpha(pixel);
+            green += qGreen(pixel) * qAlpha(pixel);
+            blue += qBlue(pixel) * qAlpha(pixel);
+            alpha += qAlpha(pixel);
+        }
+    }
+    if (alpha == 0) {
+        // Fully transparent (or missing) sprite
+        return qRgb(255, 255, 255);
+    }
+    return qRgb(static_cast<int>(red / alpha), static_cast<int>(green / alpha), static_cast<int>(blue / alpha));
+}
 
+/**
+ * @brief Sprites::getMipLevel Returns the mip level to draw a sprite of the
+ * given size with when it is size pixels wide on screen. This is the smallest
+ * level at least as large as the sprite, so the sprite is only ever shrunk
+ * when drawn.
+ * @param source Size of the sprite to be drawn
+ * @param size Width in pixels the sprite will be drawn at
+ * @return The mip level to draw with
+ */
+int Sprites::getMipLevel(QSize source, double size) {
+    int level = 0;
+    while (level < NumMipLevels - 1 && (1 << level) < size) {
+        level++;
+    }
+    return std::min(level, getTopMipLevel(source));
+}
 
+/**
+ * @brief Sprites::getTopMipLevel Returns the first mip level at which a
+ * sprite of the given size is drawn from its full size image rather than a
+ * scaled copy.
+ * @param source Size of the sprite
+ * @return The sprite's top mip level
+ */
+int Sprites::getTopMipLevel(QSize source) {
+    int level = 0;
+    while (level < NumMipLevels - 1 && (1 << level) < source.width()) {
+        level++;
+    }
+    return level;
+}
 
+/**
+ * @brief Sprites::getMipSize Returns the size of the given mip level of a
+ * sprite, without creating it.
+ * @param source Size of the sprite
+ * @param level The mip level
+ * @return The size in pixels of the mip
+ */
+QSize Sprites::getMipSize(QSize source, int level) {
+    if (level >= getTopMipLevel(source)) {
+        return source;
+    }
+    int width = 1 << level;
+    // Keep the sprite's aspect ratio
+    int height = static_cast<int>(round(source.height() * width / static_cast<double>(source.width())));
+    return QSize(width, std::max(height, 1));
+}
 
+/**
+ * @brief Sprites::getMip Returns the given sprite scaled to the given mip
+ * level. Mips are created the first time they are needed and kept until they
+ * are the least recently used once the cache is full.
+ * The returned pixmap is only valid until the next call.
+ * @param source The sprite
+ * @param level The mip level, from getMipLevel
+ * @return The scaled sprite
+ */
+const QPixmap& Sprites::getMip(const QPixmap &source, int level) {
+    if (level >= getTopMipLevel(source.size())) {
+        // Drawn from the full size image
+        return source;
+    }
+    std::pair<qint64, int> key(source.cacheKey(), level);
+    Mip *mip = findMip(key);
+    if (mip == nullptr) {
+        QPixmap pixmap = source.scaled(getMipSize(source.size(), level), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        mip = addMip(key, static_cast<long long>(pixmap.width()) * pixmap.height() * pixmap.depth() / 8);
+        mip->pixmap = pixmap;
+    }
+    return mip->pixmap;
+}
 
+/**
+ * @brief Sprites::getMip Returns the given sprite scaled to the given mip
+ * level, as an image. Unlike pixmaps, images can be drawn outside the GUI
+ * thread, but the cache itself must only be used from one thread.
+ * The returned image is only valid until the next call.
+ * @param source The sprite
+ * @param level The mip level, from getMipLevel
+ * @return The scaled sprite
+ */
+const QImage& Sprites::getMip(const QImage &source, int level) {
+    if (level >= getTopMipLevel(source.size())) {
+        // Drawn from the full size image
+        return source;
+    }
+    // Images are numbered separately to pixmaps, so keep them apart
+    std::pair<qint64, int> key(source.cacheKey(), NumMipLevels + level);
+    Mip *mip = findMip(key);
+    if (mip == nullptr) {
+        QImage image = source.scaled(getMipSize(source.size(), level), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        mip = addMip(key, static_cast<long long>(image.width()) * image.height() * image.depth() / 8);
+        mip->image = image;
+    }
+    return mip->image;
+}
 
+/**
+ * @brief Sprites::findMip Finds the mip with the given key in the cache,
+ * marking it as just used.
+ * @param key The source's cache key and the mip level
+ * @return The mip, or nullptr if it isn't cached
+ */
+Sprites::Mip* Sprites::findMip(std::pair<qint64, int> key) {
+    std::map<std::pair<qint64, int>, Mip>::iterator found = mipCache.find(key);
+    if (found == mipCache.end()) {
+        cacheMisses++;
+        return nullptr;
+    }
+    cacheHits++;
+    found->second.lastUsed = ++cacheUseCount;
+    return &found->second;
+}
 
+/**
+ * @brief Sprites::addMip Adds an empty mip to the cache, first dropping the
+ * least recently used mips until there is room for it.
+ * @param key The source's cache key and the mip level
+ * @param bytes Memory the mip will use
+ * @return The new mip, to be filled in by the caller
+ */
+Sprites::Mip* Sprites::addMip(std::pair<qint64, int> key, long long bytes) {
+    while (cacheMemory + bytes > SPRITE_CACHE_MEMORY && !mipCache.empty()) {
+        std::map<std::pair<qint64, int>, Mip>::iterator oldest = mipCache.begin();
+        for (std::map<std::pair<qint64, int>, Mip>::iterator iter = mipCache.begin(), end = mipCache.end(); iter != end; ++iter) {
+            if (iter->second.lastUsed < oldest->second.lastUsed) {
+                oldest = iter;
+            }
+        }
+        cacheMemory -= oldest->second.bytes;
+        mipCache.erase(oldest);
+    }
 
+    Mip &mip = mipCache[key];
+    mip.bytes = bytes;
+    mip.lastUsed = ++cacheUseCount;
+    cacheMemory += bytes;
+    return &mip;
+}
 
+/**
+ * @brief Sprites::getCacheHits Returns how many times a scaled sprite was
+ * found in the cache.
+ * @return The number of cache hits
+ */
+long long Sprites::getCacheHits() {
+    return cacheHits;
+}
 
+/**
+ * @brief Sprites::getCacheMisses Returns how many times a scaled sprite had
+ * to be created.
+ * @return The number of cache misses
+ */
+long long Sprites::getCacheMisses() {
+    return cacheMisses;
+}
 
+/**
+ * @brief Sprites::getCacheMemory Returns how much memory the scaled sprites
+ * are using.
+ * @return The memory used in bytes
+ */
+long long Sprites::getCacheMemory() {
+    return cacheMemory;
+}
 
+/**
+ * @brief Sprites::sliceSpriteSheet Cuts the sprite sheet into its separate
+ * images, where there are width number of images in each row of the sprite
+ * sheet, and height number of images in each column.
+ * @param spriteSheet The sprite sheet
+ * @param width The number of images in each row of the sprite sheet
+ * @param height The number of images in each column of the sprite sheet
+ * @return The images, counting from top left to bottom right
+ */
+std::vector<QPixmap> Sprites::sliceSpriteSheet(const QPixmap &spriteSheet, int width, int height) {
+    // Width in pixels for each sprite = number of pixels per row / number of sprites per row
+    int widthPerSprite = spriteSheet.width() / width;
+    int heightPerSprite = spriteSheet.height() / height;
+
+    std::vector<QPixmap> frames;
+    frames.reserve(static_cast<size_t>(width * height));
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width; col++) {
+            frames.push_back(spriteSheet.copy(col * widthPerSprite, row * heightPerSprite,
+                                              widthPerSprite, heightPerSprite));
+        }
+    }
+    return frames;
+}
 
+/**
+ * @brief Sprites::getAnimationLength Returns the number of frames in the
+ * given animation.
+ * @param id The animation
+ * @return The number of frames
+ */
+int Sprites::getAnimationLength(AnimationId id) {
+    return static_cast<int>(animations[id].size());
+}
 
+/**
+ * @brief Sprites::getAnimationFrame Returns the n'th frame of the given
+ * animation at its full size.
+ * @param id The animation
+ * @param n The number of the frame, counting from 0
+ * @return The frame
+ */
+const QPixmap& Sprites::getAnimationFrame(AnimationId id, int n) {
+    return animations[id][static_cast<size_t>(n)];
+}
 
-
-
-
-
-
-
-
-
+/**
+ * @brief Sprites::getAnimationFrame Returns the n'th frame of the given
+ * animation, at the nearest mip level to size so it can be drawn with a
+ * single blit.
+ * The returned pixmap is only valid until the next call.
+ * @param id The animation
+ * @param n The number of the frame, counting from 0
+ * @param size Width in pixels the frame will be drawn at
+ * @return The frame
+ */
+const QPixmap& Sprites::getAnimationFrame(AnimationId id, int n, int size) {
+    const QPixmap &frame = getAnimationFrame(id, n);
+    return getMip(frame, getMipLevel(frame.size(), size));
+}
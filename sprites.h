@@ -1,15 +1,55 @@
 #ifndef SPRITES_H
 #define SPRITES_H
 
+#include <map>
+#include <vector>
 #include <QtGui>
 #include "body.h"
 #include "rocket.h"
 
 class Sprites {
 public:
+    // Every sprite a body can be drawn with
+    enum SpriteId {
+        InvalidSprite = 0,
+        AsteroidSprite,
+        Planet1Sprite,
+        Planet2Sprite,
+        Planet3Sprite,
+        Planet4Sprite,
+        Planet5Sprite,
+        StarSprite,
+        WhiteDwarfSprite,
+        BlackHoleSprite,
+        RocketIdleSprite,
+        RocketFiringSprite,
+        NumSprites
+    };
+
+    // Every animation played from a sprite sheet
+    enum AnimationId {
+        RocketExplosionAnimation = 0,
+        NumAnimations
+    };
+
+    // Number of power-of-two sizes sprites are cached at (1 to 1024 pixels)
+    static const int NumMipLevels = 11;
+
     Sprites();
     QPixmap getImage(Body* b);
-    QPixmap getSpriteSheetImage(QPixmap spriteSheet, int width, int height, int n, int spriteWidth, int spriteHeight);
+    SpriteId getSpriteId(Body *b);
+    const QPixmap& getSprite(SpriteId id);
+    QRgb getAverageColor(SpriteId id);
+    int getAnimationLength(AnimationId id);
+    const QPixmap& getAnimationFrame(AnimationId id, int n);
+    const QPixmap& getAnimationFrame(AnimationId id, int n, int size);
+    static int getMipLevel(QSize source, double size);
+    static QSize getMipSize(QSize source, int level);
+    const QPixmap& getMip(const QPixmap &source, int level);
+    const QImage& getMip(const QImage &source, int level);
+    long long getCacheHits();
+    long long getCacheMisses();
+    long long getCacheMemory();
 
     QPixmap invalidImage;
     QPixmap backgroundImage;
@@ -31,8 +71,34 @@ public:
     QPixmap rocketExplosionSpriteSheet;
 
 private:
+    // A scaled copy of a sprite, either as a pixmap or as an image
+    struct Mip {
+        QPixmap pixmap;
+        QImage image;
+        long long bytes;
+        // When the mip was last drawn, used to drop the least recently used
+        long long lastUsed;
+    };
+
     QPixmap loadImage(char path[]);
-    QPixmap getPlanetImage(int t);
+    static std::vector<QPixmap> sliceSpriteSheet(const QPixmap &spriteSheet, int width, int height);
+    static QRgb calculateAverageColor(const QPixmap &sprite);
+    static int getTopMipLevel(QSize source);
+    Mip* findMip(std::pair<qint64, int> key);
+    Mip* addMip(std::pair<qint64, int> key, long long bytes);
+
+    // Average colour of each sprite, for drawing bodies too small to see the sprite
+    QRgb averageColors[NumSprites];
+    // Frames of each animation, cut out of their sprite sheets when loaded
+    std::vector<QPixmap> animations[NumAnimations];
+    // Scaled sprites, keyed by the source's cache key and the mip level
+    // (offset by NumMipLevels for images)
+    std::map<std::pair<qint64, int>, Mip> mipCache;
+    // Bytes used by the mips in mipCache
+    long long cacheMemory = 0;
+    long long cacheHits = 0;
+    long long cacheMisses = 0;
+    long long cacheUseCount = 0;
 };
 
 #endif // SPRITES_H
@@ -0,0 +1,131 @@
+#include <cmath>
+#include <algorithm>
+#include "systemindex.h"
+
+/**
+ * @brief SystemIndex::clear Removes every system from the index.
+ */
+void SystemIndex::clear() {
+    entries.clear();
+}
+
+/**
+ * @brief SystemIndex::insert Adds the centre of a system to the index.
+ * build() must be called before the index is searched again.
+ * @param x x-coordinate of the centre
+ * @param y y-coordinate of the centre
+ */
+void SystemIndex::insert(double x, double y) {
+    Entry e;
+    e.cell = cellKey(cellOf(x), cellOf(y));
+    e.x = x;
+    e.y = y;
+    entries.push_back(e);
+}
+
+/**
+ * @brief SystemIndex::build Sorts the inserted centres so that they can be
+ * searched.
+ */
+void SystemIndex::build() {
+    std::sort(entries.begin(), entries.end());
+}
+
+/**
+ * @brief SystemIndex::anyWithin Finds whether any system's centre is within
+ * the given distance of a point.
+ * @param x x-coordinate of the point
+ * @param y y-coordinate of the point
+ * @param radius The distance to search
+ * @return True if there is a system within radius of the point
+ */
+bool SystemIndex::anyWithin(double x, double y, double radius) {
+    double sqDist = radius * radius;
+    QPointF found;
+    for (int cellX = cellOf(x - radius); cellX <= cellOf(x + radius); cellX++) {
+        searchRow(cellX, cellOf(y - radius), cellOf(y + radius), x, y, &sqDist, &found);
+    }
+    return sqDist < radius * radius;
+}
+
+/**
+ * @brief SystemIndex::findNearest Finds the system centre nearest to a point.
+ * Cells are searched in growing rings around the point, stopping once no
+ * unsearched cell could hold anything nearer.
+ * @param x x-coordinate of the point
+ * @param y y-coordinate of the point
+ * @param maxDistance Systems further away than this are ignored
+ * @param nearest Set to the centre of the nearest system, if one was found
+ * @return True if there is a system within maxDistance of the point
+ */
+bool SystemIndex::findNearest(double x, double y, double maxDistance, QPointF *nearest) {
+    double bestSqDist = maxDistance * maxDistance;
+    int centreX = cellOf(x), centreY = cellOf(y);
+    int maxRing = static_cast<int>(maxDistance / SYSTEM_INDEX_CELL_SIZE) + 1;
+    for (int ring = 0; ring <= maxRing; ring++) {
+        // Anything in this ring or further out is at least this far away
+        double ringDist = (ring - 1) * static_cast<double>(SYSTEM_INDEX_CELL_SIZE);
+        if (ringDist > 0 && ringDist * ringDist >= bestSqDist) break;
+        if (ring == 0) {
+            searchRow(centreX, centreY, centreY, x, y, &bestSqDist, nearest);
+            continue;
+        }
+        // Left and right columns of the ring, then the tops and bottoms between them
+        searchRow(centreX - ring, centreY - ring, centreY + ring, x, y, &bestSqDist, nearest);
+        searchRow(centreX + ring, centreY - ring, centreY + ring, x, y, &bestSqDist, nearest);
+        for (int cellX = centreX - ring + 1; cellX < centreX + ring; cellX++) {
+            searchRow(cellX, centreY - ring, centreY - ring, x, y, &bestSqDist, nearest);
+            searchRow(cellX, centreY + ring, centreY + ring, x, y, &bestSqDist, nearest);
+        }
+    }
+    return bestSqDist < maxDistance * maxDistance;
+}
+
+/**
+ * @brief SystemIndex::searchRow Checks every centre in a column of cells,
+ * which are next to each other in the sorted entries.
+ * @param cellX x-coordinate of the cells
+ * @param minCellY y-coordinate of the first cell
+ * @param maxCellY y-coordinate of the last cell
+ * @param x x-coordinate of the point being searched around
+ * @param y y-coordinate of the point being searched around
+ * @param bestSqDist Square distance to the nearest centre so far, updated
+ * if a nearer one is found
+ * @param best Set to any nearer centre found
+ */
+void SystemIndex::searchRow(int cellX, int minCellY, int maxCellY, double x, double y,
+                            double *bestSqDist, QPointF *best) {
+    Entry first;
+    first.cell = cellKey(cellX, minCellY);
+    std::vector<Entry>::iterator iter = std::lower_bound(entries.begin(), entries.end(), first);
+    uint64_t last = cellKey(cellX, maxCellY);
+    for (; iter != entries.end() && iter->cell <= last; ++iter) {
+        double sqDist = (iter->x - x) * (iter->x - x) + (iter->y - y) * (iter->y - y);
+        if (sqDist < *bestSqDist) {
+            *bestSqDist = sqDist;
+            *best = QPointF(iter->x, iter->y);
+        }
+    }
+}
+
+/**
+ * @brief SystemIndex::cellOf Returns which cell the given coordinate is in.
+ * @param coord x or y-coordinate
+ * @return x or y-coordinate of the cell
+ */
+int SystemIndex::cellOf(double coord) {
+    return static_cast<int>(floor(coord / SYSTEM_INDEX_CELL_SIZE));
+}
+
+/**
+ * @brief SystemIndex::cellKey Packs the position of a cell into one value.
+ * Keys sort by x then y, so a column of cells has consecutive keys.
+ * @param cellX x-coordinate of the cell
+ * @param cellY y-coordinate of the cell
+ * @return A value unique to the cell
+ */
+uint64_t SystemIndex::cellKey(int cellX, int cellY) {
+    // Offset so that negative coordinates sort before positive ones
+    return (static_cast<uint64_t>(static_cast<uint32_t>(cellX) ^ 0x80000000u) << 32)
+            | (static_cast<uint32_t>(cellY) ^ 0x80000000u);
+}
@@ -0,0 +1,40 @@
+#ifndef SYSTEMINDEX_H
+#define SYSTEMINDEX_H
+
+#include <cstdint>
+#include <vector>
+#include <QPointF>
+
+// Width and height of each cell of the index
+#define SYSTEM_INDEX_CELL_SIZE 1000
+
+/*
+ * Index of the centres of planetary systems, for finding systems near a
+ * point without looking at every body. Centres are sorted by the grid cell
+ * they are in, so each row of cells in a query is found with a binary
+ * search. Rebuilt whenever the systems move. Not thread safe.
+ */
+class SystemIndex {
+public:
+    void clear();
+    void insert(double x, double y);
+    void build();
+    bool anyWithin(double x, double y, double radius);
+    bool findNearest(double x, double y, double maxDistance, QPointF *nearest);
+
+private:
+    struct Entry {
+        uint64_t cell;
+        double x, y;
+        bool operator<(const Entry &e) const { return cell < e.cell; }
+    };
+
+    static int cellOf(double coord);
+    static uint64_t cellKey(int cellX, int cellY);
+    void searchRow(int cellX, int minCellY, int maxCellY, double x, double y,
+                   double *bestSqDist, QPointF *best);
+
+    std::vector<Entry> entries;
+};
+
+#endif // SYSTEMINDEX_H
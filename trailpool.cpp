@@ -0,0 +1,170 @@
+#include <algorithm>
+#include "trailpool.h"
+
+/**
+ * @brief TrailPool::TrailPool Creates an empty pool with no trails. Call
+ * resize() before use.
+ */
+TrailPool::TrailPool() {}
+
+/**
+ * @brief TrailPool::~TrailPool Destructor.
+ */
+TrailPool::~TrailPool() {
+    delete[] points;
+}
+
+/**
+ * @brief TrailPool::resize Allocates room for the given number of trails,
+ * each holding the given number of positions. Any existing trails are lost.
+ * @param numTrails Most bodies which can have a trail at once
+ * @param length Most positions in each trail
+ */
+void TrailPool::resize(int numTrails, int length) {
+    delete[] points;
+    this->numTrails = numTrails > 0 ? numTrails : 0;
+    this->length = length > 1 ? length : 2;
+    points = new float[static_cast<size_t>(this->numTrails) * static_cast<size_t>(this->length) * 2];
+    heads.assign(static_cast<size_t>(this->numTrails), 0);
+    counts.assign(static_cast<size_t>(this->numTrails), 0);
+    clear();
+}
+
+/**
+ * @brief TrailPool::clear Frees every trail.
+ */
+void TrailPool::clear() {
+    used.assign(static_cast<size_t>(numTrails), false);
+    allocated.assign(static_cast<size_t>(numTrails), false);
+    owners.assign(static_cast<size_t>(numTrails), nullptr);
+    freeTrails.clear();
+    // Hand out low numbered trails first
+    for (int i = numTrails - 1; i >= 0; i--) {
+        freeTrails.push_back(i);
+    }
+}
+
+/**
+ * @brief TrailPool::allocate Takes an empty trail for a body.
+ * @param owner The body the trail is for
+ * @return The trail's number, or -1 if every trail is in use
+ */
+int TrailPool::allocate(const void *owner) {
+    if (freeTrails.empty()) return -1;
+    int trail = freeTrails.back();
+    freeTrails.pop_back();
+    heads[static_cast<size_t>(trail)] = 0;
+    counts[static_cast<size_t>(trail)] = 0;
+    allocated[static_cast<size_t>(trail)] = true;
+    used[static_cast<size_t>(trail)] = true;
+    owners[static_cast<size_t>(trail)] = owner;
+    return trail;
+}
+
+/**
+ * @brief TrailPool::isOwner Checks whether a trail still belongs to a body.
+ * @param trail Number of the trail, or -1
+ * @param owner The body
+ * @return True if the trail is in use and was allocated for the body
+ */
+bool TrailPool::isOwner(int trail, const void *owner) {
+    if (trail < 0 || trail >= numTrails) return false;
+    return allocated[static_cast<size_t>(trail)] && owners[static_cast<size_t>(trail)] == owner;
+}
+
+/**
+ * @brief TrailPool::add Adds a position to the end of the trail, replacing
+ * the oldest position once the trail is full.
+ * @param trail The trail, from allocate()
+ * @param x x coordinate of the position
+ * @param y y coordinate of the position
+ */
+void TrailPool::add(int trail, double x, double y) {
+    size_t t = static_cast<size_t>(trail);
+    float *point = points + (t * static_cast<size_t>(length) + static_cast<size_t>(heads[t])) * 2;
+    point[0] = static_cast<float>(x);
+    point[1] = static_cast<float>(y);
+    heads[t] = (heads[t] + 1) % length;
+    if (counts[t] < length) counts[t]++;
+    used[t] = true;
+}
+
+/**
+ * @brief TrailPool::reclaim Frees every trail which hasn't been added to
+ * since the last call, since its body must have gone.
+ */
+void TrailPool::reclaim() {
+    for (int i = 0; i < numTrails; i++) {
+        if (allocated[static_cast<size_t>(i)] && !used[static_cast<size_t>(i)]) {
+            allocated[static_cast<size_t>(i)] = false;
+            owners[static_cast<size_t>(i)] = nullptr;
+            freeTrails.push_back(i);
+        }
+        used[static_cast<size_t>(i)] = false;
+    }
+}
+
+/**
+ * @brief TrailPool::translate Moves every position in every trail, for when
+ * the simulation moves its origin.
+ * @param dx Distance to move in x
+ * @param dy Distance to move in y
+ */
+void TrailPool::translate(double dx, double dy) {
+    for (int i = 0; i < numTrails; i++) {
+        if (!allocated[static_cast<size_t>(i)]) continue;
+        float *point = points + static_cast<size_t>(i) * static_cast<size_t>(length) * 2;
+        for (int j = 0; j < counts[static_cast<size_t>(i)]; j++) {
+            point[j * 2] += static_cast<float>(dx);
+            point[j * 2 + 1] += static_cast<float>(dy);
+        }
+    }
+}
+
+/**
+ * @brief TrailPool::getNumTrails
+ * @return Most bodies which can have a trail at once
+ */
+int TrailPool::getNumTrails() {
+    return numTrails;
+}
+
+/**
+ * @brief TrailPool::getLength
+ * @param trail The trail
+ * @return How many positions the trail holds
+ */
+int TrailPool::getLength(int trail) {
+    return counts[static_cast<size_t>(trail)];
+}
+
+/**
+ * @brief TrailPool::getPoint Returns the n'th position in the trail.
+ * @param trail The trail
+ * @param n Number of the position, from 0 (oldest) to getLength() - 1 (newest)
+ * @return The position
+ */
+QPointF TrailPool::getPoint(int trail, int n) {
+    size_t t = static_cast<size_t>(trail);
+    // The oldest position is at the head once the trail is full
+    int index = (heads[t] - counts[t] + n + length) % length;
+    const float *point = points + (t * static_cast<size_t>(length) + static_cast<size_t>(index)) * 2;
+    return QPointF(static_cast<double>(point[0]), static_cast<double>(point[1]));
+}
+
+/**
+ * @brief TrailPool::copyTrail Copies every position in the trail, oldest
+ * first, in at most two blocks rather than one position at a time.
+ * @param trail The trail
+ * @param copy x and y of each position are added to the end of this list
+ */
+void TrailPool::copyTrail(int trail, std::vector<float> &copy) {
+    size_t t = static_cast<size_t>(trail);
+    const float *start = points + t * static_cast<size_t>(length) * 2;
+    int count = counts[t];
+    int oldest = (heads[t] - count + length) % length;
+    // The trail may wrap around the end of its ring buffer
+    int firstPart = std::min(count, length - oldest);
+    copy.insert(copy.end(), start + oldest * 2, start + (oldest + firstPart) * 2);
+    copy.insert(copy.end(), start, start + (count - firstPart) * 2);
+}
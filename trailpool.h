@@ -0,0 +1,60 @@
+#ifndef TRAILPOOL_H
+#define TRAILPOOL_H
+
+#include <vector>
+#include <QPointF>
+
+// Copy of the trails for drawing, made along with a snapshot of the bodies
+struct TrailSnapshot {
+    // x and y of the positions of every trail, one trail after the other
+    std::vector<float> points;
+    // Number of positions in each trail
+    std::vector<int> lengths;
+    // Index in the bodies snapshot of each trail's body
+    std::vector<int> bodies;
+};
+
+/*
+ * Recent positions of bodies, for drawing the paths they have taken. Every
+ * trail is a fixed-length ring buffer inside one block which is allocated up
+ * front, so memory use stays the same however many bodies there are and
+ * however long the simulation runs. Bodies beyond the number of trails
+ * simply don't get one until another trail is freed.
+ */
+class TrailPool {
+public:
+    TrailPool();
+    ~TrailPool();
+    void resize(int numTrails, int length);
+    void clear();
+    int allocate(const void *owner);
+    bool isOwner(int trail, const void *owner);
+    void add(int trail, double x, double y);
+    void reclaim();
+    void translate(double dx, double dy);
+    int getNumTrails();
+    int getLength(int trail);
+    QPointF getPoint(int trail, int n);
+    void copyTrail(int trail, std::vector<float> &copy);
+
+private:
+    int numTrails = 0;
+    // Most positions each trail holds
+    int length = 0;
+    // x and y of every position in every trail, length pairs per trail
+    float *points = nullptr;
+    // Where each trail's next position goes
+    std::vector<int> heads;
+    // How many positions each trail holds
+    std::vector<int> counts;
+    // Whether each trail was added to since the last reclaim()
+    std::vector<bool> used;
+    // Trails which are in use
+    std::vector<bool> allocated;
+    // What each trail was allocated for. A body which was stored away and
+    // brought back may still hold the number of a trail since given to another
+    std::vector<const void*> owners;
+    std::vector<int> freeTrails;
+};
+
+#endif // TRAILPOOL_H
@@ -0,0 +1,225 @@
+#include <cmath>
+#include "universegenerator.h"
+
+// How many systems each task generates (tasks are shared between threads)
+#define SYSTEMS_PER_TASK 64
+
+/**
+ * @brief UniverseGenerator::UniverseGenerator Creates a generator which
+ * generates large numbers of systems using the given workers.
+ * @param workers Threads to generate systems on. Must not be running
+ * anything else while generate() is called
+ */
+UniverseGenerator::UniverseGenerator(WorkerPool *workers) {
+    this->workers = workers;
+}
+
+/**
+ * @brief UniverseGenerator::generate Generates the given number of planetary
+ * systems around a point. Each system is given its own cell of a square grid,
+ * so no system can overlap another and no attempts are wasted. The bodies are
+ * not added to any simulation.
+ * @param params Settings for the systems. Counts which make no sense are
+ * clamped, see clampParams()
+ * @param G Strength of gravity, for the orbits
+ * @param centre Centre of the grid
+ * @param generated The new bodies are added to the end of this list
+ */
+void UniverseGenerator::generate(const UniverseParams &params, double G, QPointF centre,
+                                 std::vector<Body*> &generated) {
+    if (params.numSystems <= 0) return;
+    this->params = clampParams(params);
+    this->G = G;
+    this->centre = centre;
+    gridWidth = static_cast<int>(ceil(sqrt(params.numSystems)));
+    // Every cell must fit a whole system
+    double minCellSize = 2 * (MAX_SYSTEM_ORBIT_RADIUS + MAX_PLANET_ORBIT_RADIUS);
+    cellSize = params.density > 0 ? 1000 / sqrt(params.density) : minCellSize;
+    if (cellSize < minCellSize) cellSize = minCellSize;
+
+    int numTasks = (params.numSystems + SYSTEMS_PER_TASK - 1) / SYSTEMS_PER_TASK;
+    if (buffers.size() < static_cast<size_t>(numTasks)) buffers.resize(static_cast<size_t>(numTasks));
+    workers->run(numTasks, [this](int task) { generateTask(task); });
+
+    // Join the tasks' bodies together, in order
+    size_t total = 0;
+    for (int i = 0; i < numTasks; i++) {
+        total += buffers[static_cast<size_t>(i)].size();
+    }
+    generated.reserve(generated.size() + total);
+    for (int i = 0; i < numTasks; i++) {
+        std::vector<Body*> &buffer = buffers[static_cast<size_t>(i)];
+        generated.insert(generated.end(), buffer.begin(), buffer.end());
+        buffer.clear();
+    }
+}
+
+/**
+ * @brief UniverseGenerator::clampParams Returns a copy of the given settings
+ * with any counts which make no sense clamped, so the random number of planets
+ * and asteroids always comes from a positive range.
+ * @param params The settings to check
+ * @return The settings with no negative counts, and maxPlanets no less than
+ * minPlanets
+ */
+UniverseParams UniverseGenerator::clampParams(const UniverseParams &params) {
+    UniverseParams valid = params;
+    if (valid.minPlanets < 0) valid.minPlanets = 0;
+    if (valid.maxPlanets < valid.minPlanets) valid.maxPlanets = valid.minPlanets;
+    if (valid.maxAsteroids < 0) valid.maxAsteroids = 0;
+    return valid;
+}
+
+/**
+ * @brief UniverseGenerator::generateTask Generates the systems of one task
+ * into the task's own list.
+ * @param task Index of the batch of SYSTEMS_PER_TASK systems to generate
+ */
+void UniverseGenerator::generateTask(int task) {
+    std::vector<Body*> &buffer = buffers[static_cast<size_t>(task)];
+    int end = (task + 1) * SYSTEMS_PER_TASK;
+    if (end > params.numSystems) end = params.numSystems;
+    // Leave room around the centre of each system for the planets' orbits
+    double range = cellSize - 2 * (MAX_SYSTEM_ORBIT_RADIUS + MAX_PLANET_ORBIT_RADIUS);
+    for (int i = task * SYSTEMS_PER_TASK; i < end; i++) {
+        int cellX = i % gridWidth, cellY = i / gridWidth;
+        // Each system has its own generator, so the result doesn't depend
+        // on which thread generated it
+        Random random(Random::sectorKey(params.seed, cellX, cellY));
+        double x = centre.x() + (cellX - gridWidth / 2.0 + 0.5) * cellSize + (random.nextDouble() - 0.5) * range;
+        double y = centre.y() + (cellY - gridWidth / 2.0 + 0.5) * cellSize + (random.nextDouble() - 0.5) * range;
+        generateSystem(x, y, params, G, random, buffer);
+    }
+}
+
+/**
+ * @brief UniverseGenerator::generateSystem Generates a planetary system
+ * centred at the given position. The central celestial body is randomly
+ * chosen between a star, dwarf star or black hole, and given a random
+ * velocity.
+ * @param x x-coordinate of the centre of the system
+ * @param y y-coordinate of the centre of the system
+ * @param params Settings for the system
+ * @param G Strength of gravity, for the orbits
+ * @param random Generator for the system
+ * @param newBodies The new bodies are added to the end of this list,
+ * central body first
+ */
+void UniverseGenerator::generateSystem(double x, double y, const UniverseParams &params, double G,
+                                       Random &random, std::vector<Body*> &newBodies) {
+    // New central body of the system
+    // Type 2 (star), 3 (dwarf star) or 4 (black hole)
+    Body *central = new Body(static_cast<Body::BodyType>(2 + random.nextInt(3)), random);
+    central->setPos(x, y);
+    // Velocity between -velocityDispersion and velocityDispersion in both x and y
+    double dispersion = params.velocityDispersion;
+    central->setVel(-dispersion + random.nextInt(100) / 100.0 * 2 * dispersion,
+                    -dispersion + random.nextInt(100) / 100.0 * 2 * dispersion);
+    // Generate the system around the central body
+    generateSystem(central, params, G, false, random, newBodies);
+}
+
+/**
+ * @brief UniverseGenerator::generateSystem Generates a planetary system with
+ * the centre being the given central body. A random number of planets
+ * are placed in orbit of the given central body, with a random number
+ * of asteroids orbiting those planets.
+ * @param central The central body of the system
+ * @param params Settings for the system
+ * @param G Strength of gravity, for the orbits
+ * @param spawnRocket Should a player-controlled rocket be placed around
+ * the first planet, instead of asteroids?
+ * @param random Generator for the planets and asteroids
+ * @param newBodies The new bodies are added to the end of this list,
+ * central body first
+ */
+void UniverseGenerator::generateSystem(Body *central, const UniverseParams &params, double G, bool spawnRocket,
+                                       Random &random, std::vector<Body*> &newBodies) {
+    Body *newPlanet;
+    Body *newAsteroid;
+    int numAsteroids;
+
+    newBodies.push_back(central);
+    // Generate between minPlanets and maxPlanets planets around the central body
+    int numPlanets = params.minPlanets + random.nextInt(params.maxPlanets - params.minPlanets + 1);
+    for (int i = 0; i < numPlanets; i++) {
+        newPlanet = new Body(Body::Planet, random);
+        placeInOrbit(newPlanet, central, MAX_SYSTEM_ORBIT_RADIUS, G, random);
+        newBodies.push_back(newPlanet);
+
+        if (spawnRocket && i == 0) {
+            // Spawn Rocket rather than asteroids
+            Rocket *newRocket = new Rocket();
+            placeInOrbit(newRocket, newPlanet, MAX_PLANET_ORBIT_RADIUS, G, random);
+            newBodies.push_back(newRocket);
+        } else {
+            // Generate between 0 and maxAsteroids asteroids for this planet
+            numAsteroids = random.nextInt(params.maxAsteroids + 1);
+            for (int j = 0; j < numAsteroids; j++) {
+                newAsteroid = new Body(Body::Asteroid, random);
+                placeInOrbit(newAsteroid, newPlanet, MAX_PLANET_ORBIT_RADIUS, G, random);
+                newBodies.push_back(newAsteroid);
+            }
+        }
+    }
+}
+
+/**
+ * @brief UniverseGenerator::placeInOrbit Places the given newBody at a
+ * random distance away from central, according to maxOrbitDistance, then
+ * calculates the velocity required to stay in orbit. The calculate position
+ * and velocity Vectors are placed into the given newBody body.
+ * @param newBody The body to place around central and calculate its orbit
+ * velocity
+ * @param central The body which newBody orbits
+ * @param maxOrbitDistance The maximum distance from central that newBody
+ * should be placed at
+ * @param G Strength of gravity
+ * @param random Generator for the position and direction of the orbit
+ */
+void UniverseGenerator::placeInOrbit(Body *newBody, Body *central, int maxOrbitDistance, double G, Random &random) {
+    double x = central->getX();
+    double y = central->getY();
+    double centralDiam;
+    if (central->getType() == Body::Star || central->getType() == Body::WhiteDwarf) {
+        centralDiam = MIN_SYSTEM_ORBIT_RADIUS;
+    } else if (central->getType()== Body::BlackHole) {
+        centralDiam = MIN_SYSTEM_ORBIT_RADIUS * 2;
+    } else {
+        centralDiam = central->getDiameter();
+    }
+    double centralMass = central->getMass();
+    Vector centralPos = central->getPos();
+    // Max distance should depend on central body?
+    // Longer for black hole since its gravitational pull is stronger --> Able to keep in orbit further?
+    double newX = x + random.nextInt(2 * maxOrbitDistance) - maxOrbitDistance;
+    double newY = y + random.nextInt(2 * maxOrbitDistance) - maxOrbitDistance;
+    // Centre of newBody must not overlap with the central body
+    // (and we want there to be at least a little bit of space between)
+    while ((newX - x) * (newX - x) + (newY - y) * (newY - y) < centralDiam * centralDiam) {
+        newX = x + random.nextInt(2 * maxOrbitDistance) - maxOrbitDistance;
+        newY = y + random.nextInt(2 * maxOrbitDistance) - maxOrbitDistance;
+    }
+    newBody->setPos(newX, newY);
+    Vector *newBodyPos = newBody->getPos();
+    // Calculate velocity of newBody
+    // v = sqrt( (G * centralMass) / radius of orbit )
+    double vel = sqrt((G * centralMass) / centralPos.distance(newBodyPos));
+    double distX = newX - centralPos.getX();
+    double distY = newY - centralPos.getY();
+    // Use trig to find the magnitude of the velocity in the x and y directions
+    // theta = tan^-1 (|distY| / |distX|)
+    double theta = tanh(distY / distX);
+    // velX = vel * sin(theta)
+    double velX = vel * sin(theta);
+    // velY = vel * cos(theta)
+    double velY = vel * cos(theta);
+    // Flip one of velX or velY to make the newBody go in the correct direction
+    // (but we don't mind whether they're going clockwise or anticlockwise)
+    if (random.nextInt(2) == 0) {
+        velX = -velX;
+    } else {
+        velY = -velY;
+    }
+    newBody->setVel(central->getVelX() + velX, central->getVelY() + velY);
+}
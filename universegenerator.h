@@ -0,0 +1,69 @@
+#ifndef UNIVERSEGENERATOR_H
+#define UNIVERSEGENERATOR_H
+
+#include <cstdint>
+#include <vector>
+#include <QPointF>
+#include "body.h"
+#include "rocket.h"
+#include "random.h"
+#include "workerpool.h"
+
+#define MAX_SYSTEM_ORBIT_RADIUS 300
+#define MIN_SYSTEM_ORBIT_RADIUS 75
+#define MAX_PLANET_ORBIT_RADIUS 20
+
+/*
+ * Settings for generating planetary systems. The defaults give the same
+ * systems as Exploration mode.
+ */
+struct UniverseParams {
+    int numSystems = 1000;
+    // Systems per 1000 x 1000 area. Limited so that systems can't overlap
+    double density = 1;
+    // Planets around each central body
+    int minPlanets = 2;
+    int maxPlanets = 5;
+    // Most asteroids around each planet
+    int maxAsteroids = 5;
+    // Largest speed of each central body in x and y
+    double velocityDispersion = 0.5;
+    // The same seed always gives the same systems
+    uint64_t seed = 0;
+    // If false, Simulation::spawnUniverse() uses the simulation's own seed
+    // instead of the one above
+    bool useSeed = false;
+};
+
+/*
+ * Generates planetary systems. Large numbers of systems are generated in
+ * parallel, each task into its own list with its own generators, and then
+ * joined together at the end.
+ */
+class UniverseGenerator {
+public:
+    UniverseGenerator(WorkerPool *workers);
+    void generate(const UniverseParams &params, double G, QPointF centre, std::vector<Body*> &generated);
+
+    static void generateSystem(double x, double y, const UniverseParams &params, double G,
+                               Random &random, std::vector<Body*> &newBodies);
+    static void generateSystem(Body *central, const UniverseParams &params, double G, bool spawnRocket,
+                               Random &random, std::vector<Body*> &newBodies);
+    static void placeInOrbit(Body *newBody, Body *central, int maxOrbitDistance, double G, Random &random);
+    static UniverseParams clampParams(const UniverseParams &params);
+
+private:
+    void generateTask(int task);
+
+    WorkerPool *workers;
+    // Bodies generated by each task
+    std::vector<std::vector<Body*> > buffers;
+    // Settings for the current call to generate(), made valid
+    UniverseParams params;
+    double G = 0;
+    QPointF centre;
+    int gridWidth = 0;
+    double cellSize = 0;
+};
+
+#endif // UNIVERSEGENERATOR_H
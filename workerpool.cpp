@@ -0,0 +1,91 @@
+#include "workerpool.h"
+
+/**
+ * @brief WorkerPool::WorkerPool Starts the worker threads, which wait until
+ * they are given a job.
+ * @param numThreads Number of threads to start, in addition to the thread
+ * which calls run()
+ */
+WorkerPool::WorkerPool(int numThreads) {
+    nextTask = 0;
+    for (int i = 0; i < numThreads; i++) {
+        threads.push_back(std::thread(&WorkerPool::work, this));
+    }
+}
+
+/**
+ * @brief WorkerPool::~WorkerPool Destructor. Stops and joins all workers.
+ */
+WorkerPool::~WorkerPool() {
+    mut.lock();
+    stopping = true;
+    mut.unlock();
+    startCondition.notify_all();
+    for (std::vector<std::thread>::iterator iter = threads.begin(); iter != threads.end(); ++iter) {
+        iter->join();
+    }
+}
+
+/**
+ * @brief WorkerPool::run Runs task(0) to task(numTasks - 1) across all
+ * threads in the pool, including the calling thread, and waits until they
+ * have all finished. Only one job may run at a time.
+ * @param numTasks Number of tasks to run
+ * @param task The function to run for each task, given the task's index
+ */
+void WorkerPool::run(int numTasks, const std::function<void(int)> &task) {
+    if (numTasks <= 0) return;
+    std::unique_lock<std::mutex> lock(mut);
+    this->task = &task;
+    this->numTasks = numTasks;
+    nextTask = 0;
+    numWorking = static_cast<int>(threads.size());
+    job++;
+    lock.unlock();
+    startCondition.notify_all();
+
+    // Help out rather than sitting idle
+    runTasks();
+
+    // Wait for the workers to finish their last tasks
+    lock.lock();
+    doneCondition.wait(lock, [this]{ return numWorking == 0; });
+    this->task = nullptr;
+}
+
+/**
+ * @brief WorkerPool::getNumThreads
+ * @return The number of worker threads, not including the calling thread
+ */
+int WorkerPool::getNumThreads() {
+    return static_cast<int>(threads.size());
+}
+
+/**
+ * @brief WorkerPool::work Main loop of each worker thread. Waits for a job,
+ * takes tasks until there are none left, then waits for the next job.
+ */
+void WorkerPool::work() {
+    unsigned int lastJob = 0;
+    std::unique_lock<std::mutex> lock(mut);
+    while (true) {
+        startCondition.wait(lock, [this, lastJob]{ return stopping || job != lastJob; });
+        if (stopping) return;
+        lastJob = job;
+        lock.unlock();
+        runTasks();
+        lock.lock();
+        if (--numWorking == 0) doneCondition.notify_one();
+    }
+}
+
+/**
+ * @brief WorkerPool::runTasks Takes and runs tasks from the current job
+ * until there are none left.
+ */
+void WorkerPool::runTasks() {
+    int i;
+    while ((i = nextTask++) < numTasks) {
+        (*task)(i);
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+/*
+ * A fixed set of threads which are started once and reused for every tick,
+ * rather than creating new threads each time. run() splits a job into a
+ * number of tasks which the workers (and the calling thread) take in turn
+ * until all are done.
+ */
+class WorkerPool {
+public:
+    WorkerPool(int numThreads);
+    ~WorkerPool();
+    void run(int numTasks, const std::function<void(int)> &task);
+    int getNumThreads();
+
+private:
+    void work();
+    void runTasks();
+
+    std::vector<std::thread> threads;
+    std::mutex mut;
+    std::condition_variable startCondition; // Signalled when a new job is available
+    std::condition_variable doneCondition; // Signalled when a worker finishes a job
+    const std::function<void(int)> *task = nullptr; // Current job
+    int numTasks = 0;
+    std::atomic<int> nextTask; // Index of the next task to be taken
+    int numWorking = 0; // Workers still working on the current job
+    unsigned int job = 0; // Incremented for every job, so workers know when there is a new one
+    bool stopping = false;
+};
+
+#endif // WORKERPOOL_H